@@ -1,14 +1,37 @@
 #include "expr.h"
 
-// =====================================================================================================================
-// visitor
-ExprVisitor::~ExprVisitor() = default;
+#include <vector>
 
 // =====================================================================================================================
 // Expr
 
+Expr::Expr(const ExprKind kind) : m_kind(kind)
+{
+	// Empty constructor.
+}
+
 Expr::~Expr() = default;
 
+void
+Expr::release(std::shared_ptr<const Expr>& child)
+{
+	// Reused, so that once it has grown, releasing a tree allocates nothing.
+	// NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+	thread_local auto* pending = new std::vector<std::shared_ptr<const Expr>>();
+	thread_local bool is_releasing = false;
+	require_nonnull_return(child);
+	pending->push_back(std::move(child));
+	require_return(!is_releasing);
+	is_releasing = true;
+	while (!pending->empty()) {
+		// If this is the last reference to the node, its destructor pushes the node's children in turn.
+		std::shared_ptr<const Expr> node = std::move(pending->back());
+		pending->pop_back();
+		node.reset();
+	}
+	is_releasing = false;
+}
+
 std::ostream&
 operator<<(std::ostream& out_s, const Expr& expr)
 {
@@ -28,11 +51,17 @@ struct std::formatter<Expr> : std::formatter<std::string> // NOLINT(altera-struc
 // =====================================================================================================================
 // Assign
 
-Assign::Assign(Token name, std::shared_ptr<const Expr> value) : m_name(std::move(name)), m_value(std::move(value))
+Assign::Assign(const Token& name, std::shared_ptr<const Expr> value)
+	: Expr(ExprKind::ASSIGN), m_name(name), m_value(std::move(value))
 {
 	// Empty constructor.
 }
 
+Assign::~Assign()
+{
+	release(m_value);
+}
+
 const Token&
 Assign::get_name() const
 {
@@ -45,12 +74,6 @@ Assign::get_value() const
 	return m_value;
 }
 
-std::any
-Assign::accept(ExprVisitor& visitor) const
-{
-	return visitor.visit_assign_expr(*this);
-}
-
 std::string
 Assign::to_string() const
 {
@@ -60,12 +83,18 @@ Assign::to_string() const
 // =====================================================================================================================
 // Binary
 
-Binary::Binary(std::shared_ptr<const Expr> left, Token opr, std::shared_ptr<const Expr> right)
-	: m_left(std::move(left)), m_opr(std::move(opr)), m_right(std::move(right))
+Binary::Binary(std::shared_ptr<const Expr> left, const Token& opr, std::shared_ptr<const Expr> right)
+	: Expr(ExprKind::BINARY), m_left(std::move(left)), m_opr(opr), m_right(std::move(right))
 {
 	// Empty constructor.
 }
 
+Binary::~Binary()
+{
+	release(m_left);
+	release(m_right);
+}
+
 const std::shared_ptr<const Expr>&
 Binary::get_left() const
 {
@@ -84,12 +113,6 @@ Binary::get_right() const
 	return m_right;
 }
 
-std::any
-Binary::accept(ExprVisitor& visitor) const
-{
-	return visitor.visit_binary_expr(*this);
-}
-
 std::string
 Binary::to_string() const
 {
@@ -100,21 +123,20 @@ Binary::to_string() const
 // =====================================================================================================================
 // Grouping
 
-Grouping::Grouping(std::shared_ptr<const Expr> expr) : m_expr(std::move(expr))
+Grouping::Grouping(std::shared_ptr<const Expr> expr) : Expr(ExprKind::GROUPING), m_expr(std::move(expr))
 {
 	// Empty constructor.
 }
 
-const std::shared_ptr<const Expr>&
-Grouping::get_expr() const
+Grouping::~Grouping()
 {
-	return m_expr;
+	release(m_expr);
 }
 
-std::any
-Grouping::accept(ExprVisitor& visitor) const
+const std::shared_ptr<const Expr>&
+Grouping::get_expr() const
 {
-	return visitor.visit_grouping_expr(*this);
+	return m_expr;
 }
 
 std::string
@@ -126,7 +148,7 @@ Grouping::to_string() const
 // =====================================================================================================================
 // Literal
 
-Literal::Literal(Value value) : m_value(std::move(value))
+Literal::Literal(Value value) : Expr(ExprKind::LITERAL), m_value(std::move(value))
 {
 	// Empty constructor.
 }
@@ -137,12 +159,6 @@ Literal::get_value() const
 	return m_value;
 }
 
-std::any
-Literal::accept(ExprVisitor& visitor) const
-{
-	return visitor.visit_literal_expr(*this);
-}
-
 std::string
 Literal::to_string() const
 {
@@ -152,14 +168,21 @@ Literal::to_string() const
 // =====================================================================================================================
 // Ternary
 
-Ternary::Ternary(std::shared_ptr<const Expr> condition, Token qmark, std::shared_ptr<const Expr> then_branch,
-	Token colon, std::shared_ptr<const Expr> else_branch)
-	: m_condition(std::move(condition)), m_qmark(std::move(qmark)), m_then_branch(std::move(then_branch)),
-	  m_colon(std::move(colon)), m_else_branch(std::move(else_branch))
+Ternary::Ternary(std::shared_ptr<const Expr> condition, const Token& qmark, std::shared_ptr<const Expr> then_branch,
+	const Token& colon, std::shared_ptr<const Expr> else_branch)
+	: Expr(ExprKind::TERNARY), m_condition(std::move(condition)), m_qmark(qmark), m_then_branch(std::move(then_branch)),
+	  m_colon(colon), m_else_branch(std::move(else_branch))
 {
 	// Empty constructor.
 }
 
+Ternary::~Ternary()
+{
+	release(m_condition);
+	release(m_then_branch);
+	release(m_else_branch);
+}
+
 const std::shared_ptr<const Expr>&
 Ternary::get_condition() const
 {
@@ -190,12 +213,6 @@ Ternary::get_else_branch() const
 	return m_else_branch;
 }
 
-std::any
-Ternary::accept(ExprVisitor& visitor) const
-{
-	return visitor.visit_ternary_expr(*this);
-}
-
 std::string
 Ternary::to_string() const
 {
@@ -207,11 +224,17 @@ Ternary::to_string() const
 // =====================================================================================================================
 // Unary
 
-Unary::Unary(Token opr, std::shared_ptr<const Expr> right) : m_opr(std::move(opr)), m_right(std::move(right))
+Unary::Unary(const Token& opr, std::shared_ptr<const Expr> right)
+	: Expr(ExprKind::UNARY), m_opr(opr), m_right(std::move(right))
 {
 	// Empty constructor.
 }
 
+Unary::~Unary()
+{
+	release(m_right);
+}
+
 const Token&
 Unary::get_opr() const
 {
@@ -224,12 +247,6 @@ Unary::get_right() const
 	return m_right;
 }
 
-std::any
-Unary::accept(ExprVisitor& visitor) const
-{
-	return visitor.visit_unary_expr(*this);
-}
-
 std::string
 Unary::to_string() const
 {
@@ -239,7 +256,7 @@ Unary::to_string() const
 // =====================================================================================================================
 // Variable
 
-Variable::Variable(Token name) : m_name(std::move(name))
+Variable::Variable(const Token& name) : Expr(ExprKind::VARIABLE), m_name(name)
 {
 	// Empty constructor.
 }
@@ -250,12 +267,6 @@ Variable::get_name() const
 	return m_name;
 }
 
-std::any
-Variable::accept(ExprVisitor& visitor) const
-{
-	return visitor.visit_variable_expr(*this);
-}
-
 std::string
 Variable::to_string() const
 {
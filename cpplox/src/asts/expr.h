@@ -1,11 +1,12 @@
 #ifndef expr_H
 #define expr_H
 
-#include <any>
+#include <cstdint>
 #include <memory>
 #include <ostream>
 #include <string>
 
+#include "general.h"
 #include "token.h"
 #include "value.h"
 
@@ -19,7 +20,21 @@ class Unary;
 class Variable;
 
 // =====================================================================================================================
-// Visitor class
+// Concrete class of each Expr node, to tell them apart with an integer compare instead of RTTI.
+enum class ExprKind : std::uint8_t
+{
+	ASSIGN,
+	BINARY,
+	GROUPING,
+	LITERAL,
+	TERNARY,
+	UNARY,
+	VARIABLE,
+};
+
+// =====================================================================================================================
+// Visitor class, returning `R` from every visit.
+template <typename R>
 class ExprVisitor
 {
 public:
@@ -28,15 +43,15 @@ public:
 	ExprVisitor& operator=(const ExprVisitor&) = default;
 	ExprVisitor(ExprVisitor&&) noexcept = default;
 	ExprVisitor& operator=(ExprVisitor&&) noexcept = default;
-	virtual ~ExprVisitor();
-
-	[[nodiscard]] virtual std::any visit_assign_expr(const Assign& expr) = 0;
-	[[nodiscard]] virtual std::any visit_binary_expr(const Binary& expr) = 0;
-	[[nodiscard]] virtual std::any visit_grouping_expr(const Grouping& expr) = 0;
-	[[nodiscard]] virtual std::any visit_literal_expr(const Literal& expr) = 0;
-	[[nodiscard]] virtual std::any visit_ternary_expr(const Ternary& expr) = 0;
-	[[nodiscard]] virtual std::any visit_unary_expr(const Unary& expr) = 0;
-	[[nodiscard]] virtual std::any visit_variable_expr(const Variable& expr) = 0;
+	virtual ~ExprVisitor() = default;
+
+	virtual R visit_assign_expr(const Assign& expr) = 0;
+	virtual R visit_binary_expr(const Binary& expr) = 0;
+	virtual R visit_grouping_expr(const Grouping& expr) = 0;
+	virtual R visit_literal_expr(const Literal& expr) = 0;
+	virtual R visit_ternary_expr(const Ternary& expr) = 0;
+	virtual R visit_unary_expr(const Unary& expr) = 0;
+	virtual R visit_variable_expr(const Variable& expr) = 0;
 };
 
 // =====================================================================================================================
@@ -44,28 +59,50 @@ public:
 class Expr
 {
 public:
-	Expr() = default;
+	explicit Expr(ExprKind kind);
 	Expr(const Expr&) = default;
 	Expr& operator=(const Expr&) = default;
 	Expr(Expr&&) noexcept = default;
 	Expr& operator=(Expr&&) noexcept = default;
 	virtual ~Expr();
 
-	[[nodiscard]] virtual std::any accept(ExprVisitor& visitor) const = 0;
+	// Calls the visit method for this node's class, picked by its kind instead of a virtual call.
+	template <typename R>
+	R accept(ExprVisitor<R>& visitor) const;
 	[[nodiscard]] virtual std::string to_string() const = 0;
 	friend std::ostream& operator<<(std::ostream& out_s, const Expr& expr);
+	// Defined inline so that checking the kind costs no call.
+	[[nodiscard]] ExprKind
+	kind() const
+	{
+		return m_kind;
+	}
+
+protected:
+	// Destroys `child`, and the nodes only it refers to, without recursing: the destructor of a node with children
+	// releases them, and they join the nodes that the outermost `release` running is yet to destroy. Tearing
+	// down a tree of any depth thus costs no native stack.
+	static void release(std::shared_ptr<const Expr>& child);
+
+private:
+	ExprKind m_kind;
+	CLASS_PADDING(7);
 };
 
 // =====================================================================================================================
 class Assign : public Expr
 {
 public:
-	Assign(Token name, std::shared_ptr<const Expr> value);
+	Assign(const Token& name, std::shared_ptr<const Expr> value);
+	Assign(const Assign&) = default;
+	Assign& operator=(const Assign&) = default;
+	Assign(Assign&&) noexcept = default;
+	Assign& operator=(Assign&&) noexcept = default;
+	~Assign() override;
 
 	[[nodiscard]] const Token& get_name() const;
 	[[nodiscard]] const std::shared_ptr<const Expr>& get_value() const;
 
-	[[nodiscard]] std::any accept(ExprVisitor& visitor) const override;
 	[[nodiscard]] std::string to_string() const override;
 
 private:
@@ -77,13 +114,17 @@ private:
 class Binary : public Expr
 {
 public:
-	Binary(std::shared_ptr<const Expr> left, Token opr, std::shared_ptr<const Expr> right);
+	Binary(std::shared_ptr<const Expr> left, const Token& opr, std::shared_ptr<const Expr> right);
+	Binary(const Binary&) = default;
+	Binary& operator=(const Binary&) = default;
+	Binary(Binary&&) noexcept = default;
+	Binary& operator=(Binary&&) noexcept = default;
+	~Binary() override;
 
 	[[nodiscard]] const std::shared_ptr<const Expr>& get_left() const;
 	[[nodiscard]] const Token& get_opr() const;
 	[[nodiscard]] const std::shared_ptr<const Expr>& get_right() const;
 
-	[[nodiscard]] std::any accept(ExprVisitor& visitor) const override;
 	[[nodiscard]] std::string to_string() const override;
 
 private:
@@ -97,10 +138,14 @@ class Grouping : public Expr
 {
 public:
 	explicit Grouping(std::shared_ptr<const Expr> expr);
+	Grouping(const Grouping&) = default;
+	Grouping& operator=(const Grouping&) = default;
+	Grouping(Grouping&&) noexcept = default;
+	Grouping& operator=(Grouping&&) noexcept = default;
+	~Grouping() override;
 
 	[[nodiscard]] const std::shared_ptr<const Expr>& get_expr() const;
 
-	[[nodiscard]] std::any accept(ExprVisitor& visitor) const override;
 	[[nodiscard]] std::string to_string() const override;
 
 private:
@@ -115,7 +160,6 @@ public:
 
 	[[nodiscard]] const Value& get_value() const;
 
-	[[nodiscard]] std::any accept(ExprVisitor& visitor) const override;
 	[[nodiscard]] std::string to_string() const override;
 
 private:
@@ -126,8 +170,13 @@ private:
 class Ternary : public Expr
 {
 public:
-	Ternary(std::shared_ptr<const Expr> condition, Token qmark, std::shared_ptr<const Expr> then_branch, Token colon,
-		std::shared_ptr<const Expr> else_branch);
+	Ternary(std::shared_ptr<const Expr> condition, const Token& qmark, std::shared_ptr<const Expr> then_branch,
+		const Token& colon, std::shared_ptr<const Expr> else_branch);
+	Ternary(const Ternary&) = default;
+	Ternary& operator=(const Ternary&) = default;
+	Ternary(Ternary&&) noexcept = default;
+	Ternary& operator=(Ternary&&) noexcept = default;
+	~Ternary() override;
 
 	[[nodiscard]] const std::shared_ptr<const Expr>& get_condition() const;
 	[[nodiscard]] const Token& get_qmark() const;
@@ -135,7 +184,6 @@ public:
 	[[nodiscard]] const Token& get_colon() const;
 	[[nodiscard]] const std::shared_ptr<const Expr>& get_else_branch() const;
 
-	[[nodiscard]] std::any accept(ExprVisitor& visitor) const override;
 	[[nodiscard]] std::string to_string() const override;
 
 private:
@@ -150,12 +198,16 @@ private:
 class Unary : public Expr
 {
 public:
-	Unary(Token opr, std::shared_ptr<const Expr> right);
+	Unary(const Token& opr, std::shared_ptr<const Expr> right);
+	Unary(const Unary&) = default;
+	Unary& operator=(const Unary&) = default;
+	Unary(Unary&&) noexcept = default;
+	Unary& operator=(Unary&&) noexcept = default;
+	~Unary() override;
 
 	[[nodiscard]] const Token& get_opr() const;
 	[[nodiscard]] const std::shared_ptr<const Expr>& get_right() const;
 
-	[[nodiscard]] std::any accept(ExprVisitor& visitor) const override;
 	[[nodiscard]] std::string to_string() const override;
 
 private:
@@ -167,15 +219,32 @@ private:
 class Variable : public Expr
 {
 public:
-	explicit Variable(Token name);
+	explicit Variable(const Token& name);
 
 	[[nodiscard]] const Token& get_name() const;
 
-	[[nodiscard]] std::any accept(ExprVisitor& visitor) const override;
 	[[nodiscard]] std::string to_string() const override;
 
 private:
 	Token m_name;
 };
 
+// =====================================================================================================================
+template <typename R>
+R
+Expr::accept(ExprVisitor<R>& visitor) const
+{
+	ignore_warning_begin("-Wswitch-default");
+	switch (m_kind) {
+	case ExprKind::ASSIGN: return visitor.visit_assign_expr(static_cast<const Assign&>(*this));
+	case ExprKind::BINARY: return visitor.visit_binary_expr(static_cast<const Binary&>(*this));
+	case ExprKind::GROUPING: return visitor.visit_grouping_expr(static_cast<const Grouping&>(*this));
+	case ExprKind::LITERAL: return visitor.visit_literal_expr(static_cast<const Literal&>(*this));
+	case ExprKind::TERNARY: return visitor.visit_ternary_expr(static_cast<const Ternary&>(*this));
+	case ExprKind::UNARY: return visitor.visit_unary_expr(static_cast<const Unary&>(*this));
+	case ExprKind::VARIABLE: return visitor.visit_variable_expr(static_cast<const Variable&>(*this));
+	}
+	ignore_warning_end();
+}
+
 #endif // expr_H
@@ -1,14 +1,37 @@
 #include "stmt.h"
 
-// =====================================================================================================================
-// visitor
-StmtVisitor::~StmtVisitor() = default;
+#include <vector>
 
 // =====================================================================================================================
 // Stmt
 
+Stmt::Stmt(const StmtKind kind) : m_kind(kind)
+{
+	// Empty constructor.
+}
+
 Stmt::~Stmt() = default;
 
+void
+Stmt::release(std::shared_ptr<const Stmt>& child)
+{
+	// Reused, so that once it has grown, releasing a tree allocates nothing.
+	// NOLINTNEXTLINE(cppcoreguidelines-owning-memory)
+	thread_local auto* pending = new std::vector<std::shared_ptr<const Stmt>>();
+	thread_local bool is_releasing = false;
+	require_nonnull_return(child);
+	pending->push_back(std::move(child));
+	require_return(!is_releasing);
+	is_releasing = true;
+	while (!pending->empty()) {
+		// If this is the last reference to the node, its destructor pushes the node's children in turn.
+		std::shared_ptr<const Stmt> node = std::move(pending->back());
+		pending->pop_back();
+		node.reset();
+	}
+	is_releasing = false;
+}
+
 std::ostream&
 operator<<(std::ostream& out_s, const Stmt& stmt)
 {
@@ -45,21 +68,23 @@ struct std::formatter<std::vector<std::shared_ptr<const Stmt>>> : std::formatter
 // =====================================================================================================================
 // Block
 
-Block::Block(std::vector<std::shared_ptr<const Stmt>> statements) : m_statements(std::move(statements))
+Block::Block(std::vector<std::shared_ptr<const Stmt>> statements)
+	: Stmt(StmtKind::BLOCK), m_statements(std::move(statements))
 {
 	// Empty constructor.
 }
 
-const std::vector<std::shared_ptr<const Stmt>>&
-Block::get_statements() const
+Block::~Block()
 {
-	return m_statements;
+	for (std::shared_ptr<const Stmt>& node : m_statements) {
+		release(node);
+	}
 }
 
-std::any
-Block::accept(StmtVisitor& visitor) const
+const std::vector<std::shared_ptr<const Stmt>>&
+Block::get_statements() const
 {
-	return visitor.visit_block_stmt(*this);
+	return m_statements;
 }
 
 std::string
@@ -71,7 +96,7 @@ Block::to_string() const
 // =====================================================================================================================
 // Expression
 
-Expression::Expression(std::shared_ptr<const Expr> expr) : m_expr(std::move(expr))
+Expression::Expression(std::shared_ptr<const Expr> expr) : Stmt(StmtKind::EXPRESSION), m_expr(std::move(expr))
 {
 	// Empty constructor.
 }
@@ -82,12 +107,6 @@ Expression::get_expr() const
 	return m_expr;
 }
 
-std::any
-Expression::accept(StmtVisitor& visitor) const
-{
-	return visitor.visit_expression_stmt(*this);
-}
-
 std::string
 Expression::to_string() const
 {
@@ -97,7 +116,8 @@ Expression::to_string() const
 // =====================================================================================================================
 // ExpressionResult
 
-ExpressionResult::ExpressionResult(std::shared_ptr<const Expr> expr) : m_expr(std::move(expr))
+ExpressionResult::ExpressionResult(std::shared_ptr<const Expr> expr)
+	: Stmt(StmtKind::EXPRESSIONRESULT), m_expr(std::move(expr))
 {
 	// Empty constructor.
 }
@@ -108,12 +128,6 @@ ExpressionResult::get_expr() const
 	return m_expr;
 }
 
-std::any
-ExpressionResult::accept(StmtVisitor& visitor) const
-{
-	return visitor.visit_expressionresult_stmt(*this);
-}
-
 std::string
 ExpressionResult::to_string() const
 {
@@ -123,7 +137,7 @@ ExpressionResult::to_string() const
 // =====================================================================================================================
 // Print
 
-Print::Print(std::shared_ptr<const Expr> expr) : m_expr(std::move(expr))
+Print::Print(std::shared_ptr<const Expr> expr) : Stmt(StmtKind::PRINT), m_expr(std::move(expr))
 {
 	// Empty constructor.
 }
@@ -134,12 +148,6 @@ Print::get_expr() const
 	return m_expr;
 }
 
-std::any
-Print::accept(StmtVisitor& visitor) const
-{
-	return visitor.visit_print_stmt(*this);
-}
-
 std::string
 Print::to_string() const
 {
@@ -149,8 +157,8 @@ Print::to_string() const
 // =====================================================================================================================
 // Var
 
-Var::Var(Token name, std::shared_ptr<const Expr> initializer)
-	: m_name(std::move(name)), m_initializer(std::move(initializer))
+Var::Var(const Token& name, std::shared_ptr<const Expr> initializer)
+	: Stmt(StmtKind::VAR), m_name(name), m_initializer(std::move(initializer))
 {
 	// Empty constructor.
 }
@@ -167,12 +175,6 @@ Var::get_initializer() const
 	return m_initializer;
 }
 
-std::any
-Var::accept(StmtVisitor& visitor) const
-{
-	return visitor.visit_var_stmt(*this);
-}
-
 std::string
 Var::to_string() const
 {
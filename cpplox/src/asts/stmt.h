@@ -1,13 +1,14 @@
 #ifndef stmt_H
 #define stmt_H
 
-#include <any>
+#include <cstdint>
 #include <memory>
 #include <ostream>
 #include <string>
 #include <vector>
 
 #include "expr.h"
+#include "general.h"
 #include "token.h"
 
 // Forward declarations.
@@ -18,7 +19,19 @@ class Print;
 class Var;
 
 // =====================================================================================================================
-// Visitor class
+// Concrete class of each Stmt node, to tell them apart with an integer compare instead of RTTI.
+enum class StmtKind : std::uint8_t
+{
+	BLOCK,
+	EXPRESSION,
+	EXPRESSIONRESULT,
+	PRINT,
+	VAR,
+};
+
+// =====================================================================================================================
+// Visitor class, returning `R` from every visit.
+template <typename R>
 class StmtVisitor
 {
 public:
@@ -27,13 +40,13 @@ public:
 	StmtVisitor& operator=(const StmtVisitor&) = default;
 	StmtVisitor(StmtVisitor&&) noexcept = default;
 	StmtVisitor& operator=(StmtVisitor&&) noexcept = default;
-	virtual ~StmtVisitor();
+	virtual ~StmtVisitor() = default;
 
-	[[nodiscard]] virtual std::any visit_block_stmt(const Block& stmt) = 0;
-	[[nodiscard]] virtual std::any visit_expression_stmt(const Expression& stmt) = 0;
-	[[nodiscard]] virtual std::any visit_expressionresult_stmt(const ExpressionResult& stmt) = 0;
-	[[nodiscard]] virtual std::any visit_print_stmt(const Print& stmt) = 0;
-	[[nodiscard]] virtual std::any visit_var_stmt(const Var& stmt) = 0;
+	virtual R visit_block_stmt(const Block& stmt) = 0;
+	virtual R visit_expression_stmt(const Expression& stmt) = 0;
+	virtual R visit_expressionresult_stmt(const ExpressionResult& stmt) = 0;
+	virtual R visit_print_stmt(const Print& stmt) = 0;
+	virtual R visit_var_stmt(const Var& stmt) = 0;
 };
 
 // =====================================================================================================================
@@ -41,16 +54,34 @@ public:
 class Stmt
 {
 public:
-	Stmt() = default;
+	explicit Stmt(StmtKind kind);
 	Stmt(const Stmt&) = default;
 	Stmt& operator=(const Stmt&) = default;
 	Stmt(Stmt&&) noexcept = default;
 	Stmt& operator=(Stmt&&) noexcept = default;
 	virtual ~Stmt();
 
-	[[nodiscard]] virtual std::any accept(StmtVisitor& visitor) const = 0;
+	// Calls the visit method for this node's class, picked by its kind instead of a virtual call.
+	template <typename R>
+	R accept(StmtVisitor<R>& visitor) const;
 	[[nodiscard]] virtual std::string to_string() const = 0;
 	friend std::ostream& operator<<(std::ostream& out_s, const Stmt& stmt);
+	// Defined inline so that checking the kind costs no call.
+	[[nodiscard]] StmtKind
+	kind() const
+	{
+		return m_kind;
+	}
+
+protected:
+	// Destroys `child`, and the nodes only it refers to, without recursing: the destructor of a node with children
+	// releases them, and they join the nodes that the outermost `release` running is yet to destroy. Tearing
+	// down a tree of any depth thus costs no native stack.
+	static void release(std::shared_ptr<const Stmt>& child);
+
+private:
+	StmtKind m_kind;
+	CLASS_PADDING(7);
 };
 
 // =====================================================================================================================
@@ -58,10 +89,14 @@ class Block : public Stmt
 {
 public:
 	explicit Block(std::vector<std::shared_ptr<const Stmt>> statements);
+	Block(const Block&) = default;
+	Block& operator=(const Block&) = default;
+	Block(Block&&) noexcept = default;
+	Block& operator=(Block&&) noexcept = default;
+	~Block() override;
 
 	[[nodiscard]] const std::vector<std::shared_ptr<const Stmt>>& get_statements() const;
 
-	[[nodiscard]] std::any accept(StmtVisitor& visitor) const override;
 	[[nodiscard]] std::string to_string() const override;
 
 private:
@@ -76,7 +111,6 @@ public:
 
 	[[nodiscard]] const std::shared_ptr<const Expr>& get_expr() const;
 
-	[[nodiscard]] std::any accept(StmtVisitor& visitor) const override;
 	[[nodiscard]] std::string to_string() const override;
 
 private:
@@ -91,7 +125,6 @@ public:
 
 	[[nodiscard]] const std::shared_ptr<const Expr>& get_expr() const;
 
-	[[nodiscard]] std::any accept(StmtVisitor& visitor) const override;
 	[[nodiscard]] std::string to_string() const override;
 
 private:
@@ -106,7 +139,6 @@ public:
 
 	[[nodiscard]] const std::shared_ptr<const Expr>& get_expr() const;
 
-	[[nodiscard]] std::any accept(StmtVisitor& visitor) const override;
 	[[nodiscard]] std::string to_string() const override;
 
 private:
@@ -117,12 +149,11 @@ private:
 class Var : public Stmt
 {
 public:
-	Var(Token name, std::shared_ptr<const Expr> initializer);
+	Var(const Token& name, std::shared_ptr<const Expr> initializer);
 
 	[[nodiscard]] const Token& get_name() const;
 	[[nodiscard]] const std::shared_ptr<const Expr>& get_initializer() const;
 
-	[[nodiscard]] std::any accept(StmtVisitor& visitor) const override;
 	[[nodiscard]] std::string to_string() const override;
 
 private:
@@ -130,4 +161,21 @@ private:
 	std::shared_ptr<const Expr> m_initializer;
 };
 
+// =====================================================================================================================
+template <typename R>
+R
+Stmt::accept(StmtVisitor<R>& visitor) const
+{
+	ignore_warning_begin("-Wswitch-default");
+	switch (m_kind) {
+	case StmtKind::BLOCK: return visitor.visit_block_stmt(static_cast<const Block&>(*this));
+	case StmtKind::EXPRESSION: return visitor.visit_expression_stmt(static_cast<const Expression&>(*this));
+	case StmtKind::EXPRESSIONRESULT:
+		return visitor.visit_expressionresult_stmt(static_cast<const ExpressionResult&>(*this));
+	case StmtKind::PRINT: return visitor.visit_print_stmt(static_cast<const Print&>(*this));
+	case StmtKind::VAR: return visitor.visit_var_stmt(static_cast<const Var&>(*this));
+	}
+	ignore_warning_end();
+}
+
 #endif // stmt_H
@@ -1,5 +1,8 @@
 #include "environment.h"
 
+#include <optional>
+#include <utility>
+
 #include "general.h"
 #include "runtime_error.h"
 
@@ -15,46 +18,39 @@ Environment::Environment(Environment* enclosing) : m_enclosing(enclosing)
 // =====================================================================================================================
 
 void
-Environment::define(const Token& name, const std::any& value)
+Environment::define(const Token& name, std::optional<Value> value)
 {
-	m_values[name.get_lexeme()] = value;
+	m_values[name.get_symbol()] = std::move(value);
 }
 
 // =====================================================================================================================
 
 void
-Environment::assign(const Token& name, const std::any& value) // NOLINT(misc-no-recursion)
+Environment::assign(const Token& name, const Value& value)
 {
-	auto it = m_values.find(name.get_lexeme());
-	if (it != m_values.end()) {
-		it->second = value;
-		return;
-	}
-	if (m_enclosing != nullptr) {
-		m_enclosing->assign(name, value);
-		return;
+	// Walks out through the enclosing scopes in a loop, as `get` does, so that deeply nested blocks cost no stack.
+	for (Environment* scope = this; scope != nullptr; scope = scope->m_enclosing) {
+		const auto it = scope->m_values.find(name.get_symbol());
+		if (it != scope->m_values.end()) {
+			it->second = value;
+			return;
+		}
 	}
 	throw RuntimeError(name, std::format("Undefined variable '{}'.", name.get_lexeme()));
 }
 
 // =====================================================================================================================
 
-std::any
-Environment::get(const Token& name) // NOLINT(misc-no-recursion)
+Value
+Environment::get(const Token& name) const
 {
-	auto it = m_values.find(name.get_lexeme());
-	std::any value;
-	bool defined = false;
-	if (it != m_values.end()) {
-		value = it->second;
-		defined = true;
+	for (const Environment* scope = this; scope != nullptr; scope = scope->m_enclosing) {
+		const auto it = scope->m_values.find(name.get_symbol());
+		if (it != scope->m_values.end()) {
+			require_throw(it->second.has_value(),
+				RuntimeError(name, std::format("Uninitialized variable '{}'.", name.get_lexeme())));
+			return *it->second;
+		}
 	}
-	if (!defined && m_enclosing != nullptr) {
-		value = m_enclosing->get(name);
-		defined = true;
-	}
-	require_throw(defined, RuntimeError(name, std::format("Undefined variable '{}'.", name.get_lexeme())));
-	require_throw(value.has_value(),
-		RuntimeError(name, std::format("Uninitialized variable '{}'.", name.get_lexeme())));
-	return value;
+	throw RuntimeError(name, std::format("Undefined variable '{}'.", name.get_lexeme()));
 }
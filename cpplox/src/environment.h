@@ -1,11 +1,12 @@
 #ifndef ENVIRONMENT_H
 #define ENVIRONMENT_H
 
-#include <any>
-#include <string>
+#include <optional>
 #include <unordered_map>
 
+#include "symbol_table.h"
 #include "token.h"
+#include "value.h"
 
 class Environment
 {
@@ -13,14 +14,16 @@ class Environment
 public:
 	explicit Environment(Environment* enclosing = nullptr);
 
-	void define(const Token& name, const std::any& value);
-	void assign(const Token& name, const std::any& value);
+	// Defines `name` in this scope; without a value, reading it is an error until it is assigned one.
+	void define(const Token& name, std::optional<Value> value);
+	void assign(const Token& name, const Value& value);
 
-	std::any get(const Token& name);
+	[[nodiscard]] Value get(const Token& name) const;
 
 private:
 	Environment* m_enclosing;
-	std::unordered_map<std::string, std::any> m_values;
+	// Keyed by interned name: lookups hash and compare a single integer.
+	std::unordered_map<SymbolId, std::optional<Value>> m_values;
 };
 
 #endif // ENVIRONMENT_H
@@ -0,0 +1,270 @@
+#include "incremental_front_end.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "asts/stmt.h"
+#include "general.h"
+#include "lox.h"
+#include "parser.h"
+#include "scanner.h"
+#include "token_stream.h"
+
+namespace {
+
+/*
+ *	@brief
+ *		Whether a full scan of the source would start a new token exactly where the scanned window `text` ends, so
+ *		that the tokens after it are the ones scanned before the edit.
+ *
+ *		Strings and block comments still open at the end of the window were reported there. Otherwise the window
+ *		must end in whitespace after its last token; if that gap holds a comment, it must end with a line break, which
+ *		also closes any line comment.
+ */
+bool
+ends_between_tokens(const std::string_view text, const TokenStream& tokens, const std::vector<Diagnostic>& errors)
+{
+	const bool unterminated = std::ranges::any_of(errors, [&](const Diagnostic& e) { return e.offset == text.size(); });
+	require_return_value(!unterminated, false);
+
+	const size_t last = tokens.size() - 1;
+	const size_t last_token_end = last == 0 ? 0 : tokens.get_offset(last - 1) + tokens.get_lexeme(last - 1).size();
+	const std::string_view gap = text.substr(last_token_end);
+	require_return_value(!gap.empty(), false);
+	return gap.back() == '\n' || gap.find_first_not_of(" \t\r\n") == std::string_view::npos;
+}
+
+} // namespace
+
+// =====================================================================================================================
+// Public methods.
+
+IncrementalFrontEnd::IncrementalFrontEnd(std::string source) : m_source(std::move(source))
+{
+	reparse(0, 0, 0);
+}
+
+// =====================================================================================================================
+
+void
+IncrementalFrontEnd::edit(const size_t offset, const size_t length, const std::string_view replacement)
+{
+	require_assert(offset <= m_source.size() && length <= m_source.size() - offset);
+	m_source.replace(offset, length, replacement);
+	const size_t edit_end = offset + length;
+
+	// Damaged: every declaration that examined a token ending at or after the edit, up to the first declaration that
+	// starts after it. Touching counts, since text typed right against a token may extend it.
+	const auto begin_of = [this](const Declaration& declaration) { return locate(declaration, declaration.begin); };
+	const auto end_of = [this](const Declaration& declaration) { return locate(declaration, declaration.end); };
+	auto first = std::ranges::lower_bound(m_declarations, offset, {}, end_of);
+	while (first != m_declarations.begin() && locate(*std::prev(first), std::prev(first)->lookahead_end) >= offset) {
+		--first;
+	}
+	const auto next = std::ranges::upper_bound(m_declarations, edit_end, {}, begin_of);
+
+	// Everything after the edit moves by `shift`; unsigned wrap-around makes this work for deletions as well. Scan
+	// errors in the replaced text are dropped here, as their offsets would no longer be ordered.
+	const size_t shift = replacement.size() - length;
+	move_shift_boundary(static_cast<size_t>(next - m_declarations.begin()));
+	m_pending_shift += shift;
+	const auto replaced_begin = std::ranges::lower_bound(m_scan_errors, offset, {}, &Diagnostic::offset);
+	const auto replaced_end = std::ranges::lower_bound(m_scan_errors, edit_end, {}, &Diagnostic::offset);
+	for (auto it = m_scan_errors.erase(replaced_begin, replaced_end); it != m_scan_errors.end(); ++it) {
+		it->offset += shift;
+	}
+
+	// Declarations end at their last token, and the scanner is in its initial state after any token.
+	const size_t window_begin = first == m_declarations.begin() ? 0 : end_of(*std::prev(first));
+	reparse(static_cast<size_t>(first - m_declarations.begin()), static_cast<size_t>(next - m_declarations.begin()),
+		window_begin);
+}
+
+// =====================================================================================================================
+
+std::string_view
+IncrementalFrontEnd::get_source() const
+{
+	return m_source;
+}
+
+// =====================================================================================================================
+
+std::vector<std::shared_ptr<Stmt>>
+IncrementalFrontEnd::get_statements() const
+{
+	std::vector<std::shared_ptr<Stmt>> statements;
+	statements.reserve(m_declarations.size());
+	for (const Declaration& declaration : m_declarations) {
+		if (declaration.statement != nullptr) {
+			statements.push_back(declaration.statement);
+		}
+	}
+	return statements;
+}
+
+// =====================================================================================================================
+
+std::vector<Diagnostic>
+IncrementalFrontEnd::get_diagnostics() const
+{
+	// Scan errors come first, as the interpreter reports them.
+	std::vector<Diagnostic> diagnostics = m_scan_errors;
+	for (const Declaration& declaration : m_declarations) {
+		for (const Diagnostic& diagnostic : declaration.diagnostics) {
+			diagnostics.push_back(diagnostic);
+			diagnostics.back().offset = locate(declaration, diagnostic.offset);
+		}
+	}
+	return diagnostics;
+}
+
+// =====================================================================================================================
+
+size_t
+IncrementalFrontEnd::get_reparsed_count() const
+{
+	return m_reparsed_count;
+}
+
+// =====================================================================================================================
+// Private methods.
+
+/*
+ *	@brief
+ *		Replaces the declarations [first, next) by parsing the source from `window_begin` up to where declaration
+ *		`next` begins. While that is not a point the window can end at, because the edit opened a string or comment or
+ *		a declaration that runs on, the window takes in more of the following declarations, doubling each time.
+ */
+void
+IncrementalFrontEnd::reparse(const size_t first, size_t next, const size_t window_begin)
+{
+	size_t growth = 1;
+	while (true) {
+		const size_t window_end =
+			next < m_declarations.size() ? locate(m_declarations[next], m_declarations[next].begin) : m_source.size();
+		std::optional<Window> window = parse_window(window_begin, window_end);
+		if (window.has_value()) {
+			// Typing within a declaration usually replaces it by one, so the vector is only resized when needed.
+			const size_t count = window->declarations.size();
+			const auto replaced_end = m_declarations.begin() + static_cast<ptrdiff_t>(next);
+			if (count > next - first) {
+				m_declarations.insert(replaced_end, count - (next - first), Declaration{});
+			} else {
+				m_declarations.erase(replaced_end - static_cast<ptrdiff_t>(next - first - count), replaced_end);
+			}
+			std::ranges::move(window->declarations, m_declarations.begin() + static_cast<ptrdiff_t>(first));
+			m_shift_begin = first + count;
+			m_reparsed_count = count;
+
+			// The window was scanned whole, so its scan errors replace all of those that lay in it.
+			const auto scan_begin = std::ranges::lower_bound(m_scan_errors, window_begin, {}, &Diagnostic::offset);
+			const auto scan_end = window_end == m_source.size()
+				? m_scan_errors.end()
+				: std::ranges::lower_bound(m_scan_errors, window_end, {}, &Diagnostic::offset);
+			const auto replaced = m_scan_errors.erase(scan_begin, scan_end);
+			m_scan_errors.insert(replaced, std::make_move_iterator(window->scan_errors.begin()),
+				std::make_move_iterator(window->scan_errors.end()));
+			return;
+		}
+		next = std::min(next + growth, m_declarations.size());
+		growth *= 2;
+	}
+}
+
+// =====================================================================================================================
+
+/*
+ *	@brief
+ *		Carries the pending shift over the declarations between the current boundary and `index`, so that it applies
+ *		from `index` on.
+ */
+void
+IncrementalFrontEnd::move_shift_boundary(const size_t index)
+{
+	const auto shift = [](Declaration& declaration, const size_t amount) {
+		declaration.begin += amount;
+		declaration.end += amount;
+		declaration.lookahead_end += amount;
+		for (Diagnostic& diagnostic : declaration.diagnostics) {
+			diagnostic.offset += amount;
+		}
+	};
+	for (; m_shift_begin < index; ++m_shift_begin) {
+		shift(m_declarations[m_shift_begin], m_pending_shift);
+	}
+	for (; m_shift_begin > index; --m_shift_begin) {
+		shift(m_declarations[m_shift_begin - 1], 0 - m_pending_shift);
+	}
+}
+
+// =====================================================================================================================
+
+size_t
+IncrementalFrontEnd::locate(const Declaration& declaration, const size_t offset) const
+{
+	const auto index = static_cast<size_t>(&declaration - m_declarations.data());
+	return index < m_shift_begin ? offset : offset + m_pending_shift;
+}
+
+// =====================================================================================================================
+
+/*
+ *	@brief
+ *		Scans and parses the source in [begin, end), where `begin` is between tokens and a top-level declaration starts
+ *		at `end` unless it is the end of the source. Returns nothing if the result could differ from that of a full
+ *		parse: the scanner did not finish between tokens, or a declaration depends on what follows the window.
+ */
+std::optional<IncrementalFrontEnd::Window>
+IncrementalFrontEnd::parse_window(const size_t begin, const size_t end) const
+{
+	const bool is_source_end = end == m_source.size();
+	auto text = std::make_shared<const std::string>(m_source.substr(begin, end - begin));
+
+	std::vector<Diagnostic> scan_errors;
+	std::optional<Scanner> scanner;
+	{
+		const DiagnosticCapture capture(scan_errors);
+		scanner.emplace(*text, ScanMode::PARALLEL);
+	}
+	const TokenStream& tokens = scanner->get_tokens();
+	require_return_value(is_source_end || ends_between_tokens(*text, tokens, scan_errors), std::nullopt);
+
+	const size_t end_of_file = tokens.size() - 1;
+	const auto token_end = [&](const size_t index) {
+		return begin + tokens.get_offset(index) + tokens.get_lexeme(index).size();
+	};
+
+	std::vector<Declaration> declarations;
+	Parser parser(*scanner, false);
+	while (!parser.is_at_end()) {
+		const size_t first_token = parser.get_position();
+		Declaration declaration{begin + tokens.get_offset(first_token), 0, 0, text, nullptr, {}};
+		{
+			const DiagnosticCapture capture(declaration.diagnostics);
+			declaration.statement = parser.parse_declaration();
+		}
+		const size_t last_token = parser.get_position() - 1;
+		const size_t lookahead = std::max(parser.get_lookahead(), last_token);
+		require_return_value(is_source_end || lookahead < end_of_file, std::nullopt);
+
+		declaration.end = token_end(last_token);
+		declaration.lookahead_end = token_end(lookahead);
+		for (Diagnostic& diagnostic : declaration.diagnostics) {
+			diagnostic.offset += begin;
+		}
+		declarations.push_back(std::move(declaration));
+	}
+
+	for (Diagnostic& scan_error : scan_errors) {
+		scan_error.offset += begin;
+	}
+	return Window{std::move(declarations), std::move(scan_errors)};
+}
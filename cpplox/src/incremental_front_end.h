@@ -0,0 +1,82 @@
+#ifndef INCREMENTAL_FRONT_END_H
+#define INCREMENTAL_FRONT_END_H
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "asts/stmt.h"
+#include "lox.h"
+
+/*
+ *	@brief
+ *		Keeps the syntax tree and the scan and parse diagnostics of a source that is edited in place, as editor tooling
+ *		does on every keystroke. An edit re-scans only a window of text around it and re-parses only the top-level
+ *		declarations in that window; every other declaration keeps its `Stmt` subtree and its diagnostics.
+ *
+ *		A window is scanned from a private copy of its text, which the window's declarations share, so their lexemes
+ *		stay valid however the source changes later. Token offsets inside a statement are relative to that copy;
+ *		`get_diagnostics` reports positions in the current source.
+ */
+class IncrementalFrontEnd
+{
+public:
+	explicit IncrementalFrontEnd(std::string source);
+
+	// Replaces `length` bytes at `offset` with `replacement`.
+	void edit(size_t offset, size_t length, std::string_view replacement);
+
+	[[nodiscard]] std::string_view get_source() const;
+
+	// The statements of the declarations that parsed, in source order.
+	[[nodiscard]] std::vector<std::shared_ptr<Stmt>> get_statements() const;
+
+	// All diagnostics, positioned in the current source: the scan errors, then the parse errors of each declaration.
+	[[nodiscard]] std::vector<Diagnostic> get_diagnostics() const;
+
+	// Number of top-level declarations the last edit (or the constructor) parsed.
+	[[nodiscard]] size_t get_reparsed_count() const;
+
+private:
+	/*
+	 *	@brief
+	 *		A top-level declaration and its parse errors. The declaration's tokens span [begin, end) and the parser
+	 *		examined tokens up to `lookahead_end`, which is past `end` when an error was reported at the next token.
+	 *		`statement` is null if the declaration did not parse. Offsets are resolved with `locate`.
+	 */
+	struct Declaration {
+		size_t begin;
+		size_t end;
+		size_t lookahead_end;
+		std::shared_ptr<const std::string> text;
+		std::shared_ptr<Stmt> statement;
+		std::vector<Diagnostic> diagnostics;
+	};
+
+	struct Window {
+		std::vector<Declaration> declarations;
+		std::vector<Diagnostic> scan_errors;
+	};
+
+	std::string m_source;
+	std::vector<Declaration> m_declarations;
+	// Sorted by offset. Kept apart from the declarations since most lie between them, where no token was produced.
+	std::vector<Diagnostic> m_scan_errors;
+	size_t m_reparsed_count = 0;
+
+	// Offsets stored in the declarations from `m_shift_begin` on are `m_pending_shift` bytes short. An edit only
+	// moves this boundary across the declarations between it and the previous edit, instead of updating every
+	// declaration after it.
+	size_t m_shift_begin = 0;
+	size_t m_pending_shift = 0;
+
+	void move_shift_boundary(size_t index);
+	[[nodiscard]] size_t locate(const Declaration& declaration, size_t offset) const;
+	void reparse(size_t first, size_t next, size_t window_begin);
+	[[nodiscard]] std::optional<Window> parse_window(size_t begin, size_t end) const;
+};
+
+#endif // INCREMENTAL_FRONT_END_H
@@ -1,16 +1,15 @@
 #include "lox.h"
 
-#include <any>
+#include <algorithm>
 #include <cstddef>
 #include <cstdlib>
 #include <format>
-#include <fstream>
-#include <ios>
 #include <iostream>
-#include <iterator>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <sysexits.h> // EX_DATAERR (65)
+#include <utility>
 #include <vector>
 
 #include "asts/expr.h"
@@ -18,21 +17,23 @@
 #include "parser.h"
 #include "scanner.h"
 #include "token_type.h"
+#include "utilities/arena.h"
 #include "utilities/lox_readline.h"
+#include "utilities/mapped_file.h"
+#include "value.h"
 #include "visitors/interpreter.h"
 
 void
 Lox::run_file(const std::string& path)
 {
-	std::ifstream file(path, std::ios::binary);
-	require_throw(file, std::ios_base::failure("Failed to open file: " + path));
-
-	// Read file into a byte buffer.
-	const std::vector<char> content_bytes((std::istreambuf_iterator<char>(file)), (std::istreambuf_iterator<char>()));
+	// Map the script read-only; it stays mapped until the run is over, so tokens can point straight into it.
+	const MappedFile file(path);
 
 	// Run the source.
-	run(std::string(content_bytes.begin(), content_bytes.end()));
+	run(file.get_content());
 
+	// `quick_exit` does not flush the standard streams, so errors not followed by other output would be lost.
+	std::cout.flush();
 	if (m_had_error) {
 		std::quick_exit(EX_DATAERR);
 	}
@@ -63,19 +64,58 @@ Lox::run_prompt()
 }
 
 void
-Lox::error(const size_t line, const std::string& message)
+Lox::error(const size_t offset, const std::string& message)
 {
-	report(line, "", message);
+	if (m_diagnostic_sink != nullptr) {
+		m_diagnostic_sink->push_back({offset, 0, "", message});
+		return;
+	}
+	report(locate(offset).line, "", message);
 }
 
 void
 Lox::error(const Token& token, const std::string& message)
 {
-	if (token.get_type() == TokenType::END_OF_FILE) {
-		report(token.get_line(), "at the end", message);
-	} else {
-		report(token.get_line(), std::format("at '{}'", token.get_lexeme()), message);
+	std::string where =
+		token.get_type() == TokenType::END_OF_FILE ? "at the end" : std::format("at '{}'", token.get_lexeme());
+	if (m_diagnostic_sink != nullptr) {
+		m_diagnostic_sink->push_back({token.get_offset(), token.get_lexeme().size(), std::move(where), message});
+		return;
 	}
+	report(get_line(token), where, message);
+}
+
+SourceLocation
+Lox::locate(const size_t offset)
+{
+	return get_line_index().locate(offset);
+}
+
+std::vector<Diagnostic>* Lox::m_diagnostic_sink = nullptr;
+void
+Lox::set_diagnostic_sink(std::vector<Diagnostic>* sink)
+{
+	m_diagnostic_sink = sink;
+}
+
+std::vector<Diagnostic>*
+Lox::get_diagnostic_sink()
+{
+	return m_diagnostic_sink;
+}
+
+bool Lox::m_print_stats = false;
+void
+Lox::set_print_stats(const bool print_stats)
+{
+	m_print_stats = print_stats;
+}
+
+size_t Lox::m_max_depth = Parser::default_max_depth;
+void
+Lox::set_max_depth(const size_t max_depth)
+{
+	m_max_depth = max_depth;
 }
 
 // =====================================================================================================================
@@ -90,34 +130,79 @@ Lox::get_interpreter()
 	return *interpreter;
 }
 
+LineIndex&
+Lox::get_line_index()
+{
+	static auto* line_index = new LineIndex(); // NOLINT(cppcoreguidelines-owning-memory)
+	return *line_index;
+}
+
+/*
+ *	@brief
+ *		The line a token is reported on: the line of its last character, so a string literal spanning several lines is
+ *		reported where it ends.
+ */
+size_t
+Lox::get_line(const Token& token)
+{
+	return locate(token.get_offset() + token.get_lexeme().size()).line;
+}
+
 // =====================================================================================================================
 
 void
-Lox::run(const std::string& content, const bool repl)
+Lox::run(const std::string_view content, const bool repl)
 {
 	// Reset interpreter state at the beginning to ensure no previous results are shown if parsing fails
 	get_interpreter().reset_last_expression_state();
 
-	const Scanner scanner(content);
-	const std::vector<Token>& tokens = scanner.get_tokens();
+	// Positions are only resolved into lines if something is reported.
+	get_line_index() = LineIndex(content);
+
+	// The tokens and the syntax tree of this run are allocated from one arena and released together when it returns.
+	// It is declared first so that it outlives everything allocated from it.
+	constexpr size_t min_arena_size = 4096;
+	Arena arena(std::max(content.size(), min_arena_size));
+
+	// Tokens are scanned as the parser asks for them, unless the source is large enough to be scanned in parallel.
+	const bool parallel = !repl && Scanner::parallel_chunk_count(content.size()) > 1;
+	Scanner scanner(content, parallel ? ScanMode::PARALLEL : ScanMode::ON_DEMAND, &arena);
+	Parser parser(scanner, repl, &arena);
+	parser.set_max_depth(m_max_depth);
+
+	// Parse errors are held back until the scanner has reported its own, so that errors come out in the same order
+	// as if the whole source had been scanned before parsing.
+	std::vector<Diagnostic> parse_errors;
+	std::vector<std::shared_ptr<Stmt>> statements;
+	{
+		const DiagnosticCapture capture(parse_errors);
+		statements = parser.parse();
+	}
+	scanner.finish();
+	for (const Diagnostic& diagnostic : parse_errors) {
+		report(locate(diagnostic.offset + diagnostic.length).line, diagnostic.where, diagnostic.message);
+	}
 
-	Parser parser(tokens, repl);
 	try {
-		std::vector<std::shared_ptr<Stmt>> statements = parser.parse();
 		get_interpreter().interpret(statements);
 	} catch (const std::exception& statements_e) {
-		// Parsing or interpretation failed
+		// Interpretation failed
 		(void)statements_e;
 	}
 
 	// In REPL mode, check if the last expression was evaluated
 	if (repl) {
 		bool last_expression_evaluated = false;
-		std::any last_expression_result = get_interpreter().get_last_expression_result(last_expression_evaluated);
+		const Value last_expression_result = get_interpreter().get_last_expression_result(last_expression_evaluated);
 		if (last_expression_evaluated) {
 			std::cout << Interpreter::stringify(last_expression_result) << std::endl;
 		}
 	}
+
+	if (m_print_stats) {
+		std::cerr << std::format("[stats] arena: {} bytes used, {} bytes reserved\n", arena.get_bytes_used(),
+			arena.get_bytes_reserved());
+	}
 }
 
 // =====================================================================================================================
@@ -137,6 +222,19 @@ void
 Lox::runtime_error(const RuntimeError& error)
 {
 	std::cout << error.get_message() << std::endl;
-	std::cout << std::format("[line {}]", error.get_token().get_line()) << std::endl;
+	std::cout << std::format("[line {}]", get_line(error.get_token())) << std::endl;
 	m_had_runtime_error = true;
 }
+
+// =====================================================================================================================
+// DiagnosticCapture
+
+DiagnosticCapture::DiagnosticCapture(std::vector<Diagnostic>& diagnostics) : m_previous_sink(Lox::get_diagnostic_sink())
+{
+	Lox::set_diagnostic_sink(&diagnostics);
+}
+
+DiagnosticCapture::~DiagnosticCapture()
+{
+	Lox::set_diagnostic_sink(m_previous_sink);
+}
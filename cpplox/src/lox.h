@@ -4,26 +4,79 @@
 #include "token.h"
 #include <cstddef>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "runtime_error.h"
+#include "utilities/line_index.h"
 #include "visitors/interpreter.h"
 
+/*
+ *	@brief
+ *		A scan or parse error as a byte range of the source, for tools that place errors themselves instead of printing
+ *		them. `length` is zero for errors that are not about a particular token.
+ */
+struct Diagnostic {
+	size_t offset;
+	size_t length;
+	std::string where;
+	std::string message;
+};
+
 class Lox
 {
 public:
 	static void run_file(const std::string& path);
 	static void run_prompt();
-	static void error(size_t line, const std::string& message);
+	static void error(size_t offset, const std::string& message);
 	static void error(const Token& token, const std::string& message);
 	static void runtime_error(const RuntimeError& error);
 
+	// Line and column of a byte offset in the source being run.
+	static SourceLocation locate(size_t offset);
+
+	// While a sink is set, scan and parse errors are appended to it instead of being printed. Pass null to print again.
+	// `DiagnosticCapture` sets one for a scope.
+	static void set_diagnostic_sink(std::vector<Diagnostic>* sink);
+	[[nodiscard]] static std::vector<Diagnostic>* get_diagnostic_sink();
+
+	// Whether each run reports the memory it took from its arena, on standard error.
+	static void set_print_stats(bool print_stats);
+
+	// Deepest syntax tree that each run accepts, up to `Parser::max_safe_depth`; see `Parser::default_max_depth`.
+	static void set_max_depth(size_t max_depth);
+
 private:
 	static bool m_had_error;
 	static bool m_had_runtime_error;
+	static bool m_print_stats;
+	static size_t m_max_depth;
+	static std::vector<Diagnostic>* m_diagnostic_sink;
 
 	static Interpreter& get_interpreter();
+	static LineIndex& get_line_index();
+	static size_t get_line(const Token& token);
 	static void report(size_t line, const std::string& where, const std::string& message);
-	static void run(const std::string& content, bool repl = false);
+	static void run(std::string_view content, bool repl = false);
+};
+
+/*
+ *	@brief
+ *		Collects the errors reported while it is alive into `diagnostics` instead of printing them, then puts back the
+ *		sink that was set before, so that captures nest.
+ */
+class DiagnosticCapture
+{
+public:
+	explicit DiagnosticCapture(std::vector<Diagnostic>& diagnostics);
+	DiagnosticCapture(const DiagnosticCapture&) = delete;
+	DiagnosticCapture(DiagnosticCapture&&) = delete;
+	DiagnosticCapture& operator=(const DiagnosticCapture&) = delete;
+	DiagnosticCapture& operator=(DiagnosticCapture&&) = delete;
+	~DiagnosticCapture();
+
+private:
+	std::vector<Diagnostic>* m_previous_sink;
 };
 
 #endif // LOX_H
@@ -1,8 +1,11 @@
 #include "lox.h"
 
 #include <cerrno>
+#include <charconv>
+#include <cstddef>
 #include <iostream>
 #include <string>
+#include <system_error>
 #include <vector>
 
 #include "general.h"
@@ -10,14 +13,31 @@
 // NOLINTNEXTLINE(modernize-use-trailing-return-type)
 int main(const int argc, const char* const argv[])
 {
-	require_action_return_value(argc <= 2, std::cout << "Usage: cpplox [script]" << std::endl, EINVAL);
+	std::vector<std::string> args(argv + 1, argv + argc);
+	const auto print_usage = [] { std::cout << "Usage: cpplox [--stats] [--max-depth N] [script]" << std::endl; };
 
-	std::vector<std::string> args(argv, argv + argc);
+	// Options come before the script.
+	while (!args.empty()) {
+		if (args.front() == "--stats") {
+			Lox::set_print_stats(true);
+			args.erase(args.begin());
+		} else if (args.front() == "--max-depth" && args.size() >= 2) {
+			const std::string& text = args[1];
+			size_t max_depth = 0;
+			const auto [end, status] = std::from_chars(text.data(), text.data() + text.size(), max_depth);
+			require_action_return_value(status == std::errc() && end == text.data() + text.size() && max_depth > 0,
+				print_usage(), EINVAL);
+			Lox::set_max_depth(max_depth);
+			args.erase(args.begin(), args.begin() + 2);
+		} else {
+			break;
+		}
+	}
+	require_action_return_value(args.size() <= 1, print_usage(), EINVAL);
 
-	if (argc == 2) {
-		Lox::run_file(args[1]);
+	if (args.size() == 1) {
+		Lox::run_file(args[0]);
 	} else {
-		// argc == 1
 		Lox::run_prompt();
 	}
 	return 0;
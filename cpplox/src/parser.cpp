@@ -1,33 +1,82 @@
 #include "parser.h"
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <format>
 #include <memory>
-#include <stdexcept>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <utility>
 
 #include "asts/expr.h"
 #include "asts/stmt.h"
 #include "general.h"
 #include "lox.h"
+#include "scanner.h"
 #include "token.h"
 #include "token_type.h"
 
 namespace {
 
-class ParserError : public std::runtime_error // NOLINT(hicpp-special-member-functions,
-											  // cppcoreguidelines-special-member-functions)
+// Messages are only turned into strings once an error is actually reported.
+void
+error(const Token& token, const std::string_view message)
 {
-public:
-	explicit ParserError(const std::string& message) : std::runtime_error(message)
-	{
-		// Empty constructor.
-	}
-	~ParserError() override;
+	Lox::error(token, std::string(message));
+}
+
+constexpr TokenSet unary_operators(TokenType::BANG, TokenType::MINUS);
+constexpr TokenSet literal_tokens(TokenType::NUMBER, TokenType::STRING);
+
+// =====================================================================================================================
+// Expression parse table.
+
+struct ParseRule {
+	// The level of the token as a binary operator, or NONE if it is not one.
+	Precedence infix = Precedence::NONE;
+	// Reported when the operator appears where an operand should start; empty if it is then an error of its own.
+	std::string_view missing_left_operand;
 };
 
-ParserError
-error(const Token& token, const std::string& message)
+consteval std::array<ParseRule, token_type_count>
+make_parse_rules()
+{
+	std::array<ParseRule, token_type_count> rules{};
+	const auto rule = [&rules](const TokenType type, const Precedence infix, const std::string_view missing = {}) {
+		rules[static_cast<size_t>(type)] = ParseRule{infix, missing};
+	};
+	rule(TokenType::COMMA, Precedence::COMMA);
+	rule(TokenType::QUESTION, Precedence::CONDITIONAL);
+	rule(TokenType::EQUAL, Precedence::ASSIGNMENT);
+	rule(TokenType::BANG_EQUAL, Precedence::EQUALITY, "Expect left operand before equality operator.");
+	rule(TokenType::EQUAL_EQUAL, Precedence::EQUALITY, "Expect left operand before equality operator.");
+	rule(TokenType::GREATER, Precedence::COMPARISON, "Expect left operand before comparison operator.");
+	rule(TokenType::GREATER_EQUAL, Precedence::COMPARISON, "Expect left operand before comparison operator.");
+	rule(TokenType::LESS, Precedence::COMPARISON, "Expect left operand before comparison operator.");
+	rule(TokenType::LESS_EQUAL, Precedence::COMPARISON, "Expect left operand before comparison operator.");
+	// `-` is also a unary operator, so a leading one is not missing its left operand.
+	rule(TokenType::MINUS, Precedence::TERM);
+	rule(TokenType::PLUS, Precedence::TERM, "Expect left operand before term operator.");
+	rule(TokenType::SLASH, Precedence::FACTOR, "Expect left operand before factor operator.");
+	rule(TokenType::STAR, Precedence::FACTOR, "Expect left operand before factor operator.");
+	return rules;
+}
+
+constexpr std::array<ParseRule, token_type_count> parse_rules = make_parse_rules();
+
+constexpr const ParseRule&
+parse_rule(const TokenType type)
+{
+	return parse_rules[static_cast<size_t>(type)];
+}
+
+constexpr Precedence
+next_tighter(const Precedence precedence)
 {
-	Lox::error(token, message);
-	return ParserError(message);
+	return static_cast<Precedence>(static_cast<std::uint8_t>(precedence) + 1);
 }
 
 } // namespace
@@ -35,21 +84,28 @@ error(const Token& token, const std::string& message)
 // =====================================================================================================================
 // Public methods.
 
+Parser::Parser(Scanner& scanner, const bool is_repl_mode, std::pmr::memory_resource* const resource)
+	: m_scanner(&scanner), m_allocator(resource),
+	  m_ring{Token(TokenType::END_OF_FILE, 0), Token(TokenType::END_OF_FILE, 0)}, m_is_repl_mode(is_repl_mode)
+{
+	pull();
+}
+
+// =====================================================================================================================
+
 std::vector<std::shared_ptr<Stmt>>
 Parser::parse()
 {
 	std::vector<std::shared_ptr<Stmt>> statements;
 
 	while (!is_at_end()) {
-		std::shared_ptr<Stmt> statement = declaration();
+		std::shared_ptr<Stmt> statement = parse_declaration();
 		if (statement != nullptr) {
-			// Check if this statement is an ExpressionResult (expression without semicolon in REPL mode)
-			auto expr_result = std::dynamic_pointer_cast<const ExpressionResult>(statement);
-
-			// If it's an ExpressionResult, ensure it's the last statement
-			if (expr_result && !is_at_end()) {
-				// Not the last statement, so this should have had a semicolon
-				throw error(previous(), "Expect ';' after expression.");
+			// An ExpressionResult (expression without semicolon in REPL mode) must be the last statement
+			if (statement->kind() == StmtKind::EXPRESSIONRESULT && !is_at_end()) {
+				// Not the last statement, so this should have had a semicolon. The input is rejected as a whole.
+				error(previous(), "Expect ';' after expression.");
+				return {};
 			}
 
 			statements.push_back(statement);
@@ -60,211 +116,261 @@ Parser::parse()
 }
 
 // =====================================================================================================================
-// Private methods.
+
+std::shared_ptr<Stmt>
+Parser::parse_declaration()
+{
+	m_lookahead = current;
+	return declaration();
+}
 
 // =====================================================================================================================
-// Expression grammar.
 
-// <comma_expression> -> <expression> ( "," <expression> )*
-std::shared_ptr<Expr>
-Parser::comma_expression() // NOLINT(misc-no-recursion)
+bool
+Parser::is_at_end() const
 {
-	std::shared_ptr<Expr> expr = conditional_expression();
-	while (match(TokenType::COMMA)) {
-		const Token& comma_opr = previous();
-		std::shared_ptr<Expr> right = conditional_expression();
-		expr = std::make_shared<Binary>(expr, comma_opr, right);
-	}
-	return expr;
+	m_lookahead = std::max(m_lookahead, current);
+	return m_ring[current % ring_size].get_type() == TokenType::END_OF_FILE;
 }
 
 // =====================================================================================================================
 
-// conditional_expression	-> expression ? expression : conditional_expression:
-// 							| expression
-std::shared_ptr<Expr>
-Parser::conditional_expression() // NOLINT(misc-no-recursion)
+size_t
+Parser::get_position() const
 {
-	std::shared_ptr<Expr> expr = expression();
-	if (match(TokenType::QUESTION)) {
-		const Token& qmark = previous();
-		std::shared_ptr<Expr> then_branch = expression();
-		consume(TokenType::COLON, "Expect ':' after expression.");
-		std::shared_ptr<Expr> else_branch = conditional_expression();
-		expr = std::make_shared<Ternary>(expr, qmark, then_branch, previous(), else_branch);
-	}
-	return expr;
+	return current;
 }
 
 // =====================================================================================================================
 
-// <expression> -> <equality>
-std::shared_ptr<Expr>
-Parser::expression() // NOLINT(misc-no-recursion)
+size_t
+Parser::get_lookahead() const
 {
-	return assignment();
+	return m_lookahead;
 }
 
 // =====================================================================================================================
 
-// <assignment> -> IDENTIFIER "=" <assignment> | <equality>
-std::shared_ptr<Expr>
-Parser::assignment() // NOLINT(misc-no-recursion)
+void
+Parser::set_max_depth(const size_t max_depth)
 {
-	std::shared_ptr<Expr> expr = equality();
-	if (match(TokenType::EQUAL)) {
-		const Token& equals = previous();
-		std::shared_ptr<Expr> value = assignment();
-		if (std::shared_ptr<Variable> variable = std::dynamic_pointer_cast<Variable>(expr)) {
-			const Token& name = variable->get_name();
-			return std::make_shared<Assign>(name, value);
-		}
-		error(equals, "Invalid assignment target.");
-	}
-	return expr;
+	m_max_depth = std::min(max_depth, max_safe_depth);
 }
 
 // =====================================================================================================================
+// Private methods.
 
-// <equality> -> <comparison> ( ( "!=" | "==" ) <comparison> )*
-std::shared_ptr<Expr>
-Parser::equality() // NOLINT(misc-no-recursion)
-{
-	// Error handling for equality that does not have a left operand.
-	if (match(TokenType::BANG_EQUAL, TokenType::EQUAL_EQUAL)) {
-		const Token& eq_opr = previous();
-		error(eq_opr, "Expect left operand before equality operator.");
-		// Parse the right operand and continue parsing.
-		std::shared_ptr<Expr> right = comparison();
-		return right;
-	}
+// =====================================================================================================================
+// Expression grammar.
 
-	// Think about `a == b == c == d == e`.
-	std::shared_ptr<Expr> expr = comparison();
-	while (match(TokenType::BANG_EQUAL, TokenType::EQUAL_EQUAL)) {
-		const Token& eq_opr = previous();
-		std::shared_ptr<Expr> right = comparison();
-		expr = std::make_shared<Binary>(expr, eq_opr, right);
-	}
-	return expr;
+// <comma_expression> -> <expression> ( "," <expression> )*
+std::shared_ptr<Expr>
+Parser::comma_expression()
+{
+	return parse_expression(Precedence::COMMA);
 }
 
 // =====================================================================================================================
 
-// <comparison> -> <term> ( ( ">" | ">=" | "<" | "<=" ) <term> )*
+// <expression> -> <assignment>
 std::shared_ptr<Expr>
-Parser::comparison() // NOLINT(misc-no-recursion)
+Parser::expression()
 {
-
-	// Error handling for comparison that does not have a left operand.
-	if (match(TokenType::GREATER, TokenType::GREATER_EQUAL, TokenType::LESS, TokenType::LESS_EQUAL)) {
-		const Token& cmp_opr = previous();
-		error(cmp_opr, "Expect left operand before comparison operator.");
-		// Parse the right operand and continue parsing.
-		std::shared_ptr<Expr> right = term();
-		return right;
-	}
-
-	std::shared_ptr<Expr> expr = term();
-	while (match(TokenType::GREATER, TokenType::GREATER_EQUAL, TokenType::LESS, TokenType::LESS_EQUAL)) {
-		const Token& cmp_opr = previous();
-		std::shared_ptr<Expr> right = term();
-		expr = std::make_shared<Binary>(expr, cmp_opr, right);
-	}
-	return expr;
+	return parse_expression(Precedence::ASSIGNMENT);
 }
 
 // =====================================================================================================================
 
-// <term> -> <factor> ( ( "-" | "+" ) <factor> )*
+/*
+ *	@brief
+ *		Parses an expression whose binary operators are all at level `lowest` or tighter, without recursing. Every
+ *		expression started inside it, whether in parentheses, after a unary operator or as the right operand of a
+ *		binary operator, is a frame on `m_frames` that its operand is handed back to once complete. Nodes are built
+ *		in the same order, and from the same tokens, as the nested grammar rules would build them.
+ *
+ *		Returns null after reporting a syntax error; the frames are then abandoned and nothing more is examined.
+ */
 std::shared_ptr<Expr>
-Parser::term() // NOLINT(misc-no-recursion)
-{
-	// Error handling for term that does not have a left operand.
-	// Note that `-` is a unary operator, so we don't need to check for it here.
-	if (match(TokenType::PLUS)) {
-		const Token& add_opr = previous();
-		error(add_opr, "Expect left operand before term operator.");
-		// Parse the right operand and continue parsing.
-		std::shared_ptr<Expr> right = factor();
-		return right;
+Parser::parse_expression(const Precedence lowest)
+{
+	m_frames.clear();
+	require_return_value(push_frame(ExprFrame::Kind::OPERATORS, lowest), nullptr);
+	while (true) {
+		Operand operand = parse_prefix();
+		if (operand.expr == nullptr || parse_infix(operand)) {
+			return std::move(operand.expr);
+		}
 	}
+}
 
-	std::shared_ptr<Expr> expr = factor();
-	while (match(TokenType::MINUS, TokenType::PLUS)) {
-		const Token& add_opr = previous();
-		std::shared_ptr<Expr> right = factor();
-		expr = std::make_shared<Binary>(expr, add_opr, right);
+// =====================================================================================================================
+
+/*
+ *	@brief
+ *		Parses up to the next primary expression, opening a frame for each unary operator and opening parenthesis.
+ *
+ *		An equality, comparison, `+` or factor operator where an expression starts is reported as missing its left
+ *		operand, and the operand after it is parsed as that operator's right operand. As in the grammar rule that
+ *		reports it, only looser operators may continue the expression from there.
+ */
+Parser::Operand
+Parser::parse_prefix()
+{
+	while (true) {
+		const ExprFrame& top = m_frames.back();
+		const bool at_start = top.kind != ExprFrame::Kind::UNARY && top.left.expr == nullptr;
+		const ParseRule& leading = parse_rule(peek().get_type());
+		bool pushed = true;
+		if (at_start && !leading.missing_left_operand.empty() && leading.infix >= top.lowest) {
+			advance();
+			error(previous(), leading.missing_left_operand);
+			m_frames.back().limit = leading.infix;
+			pushed = push_frame(ExprFrame::Kind::OPERATORS, next_tighter(leading.infix));
+		} else if (match(unary_operators)) {
+			// <unary> -> ( "!" | "-" ) <unary> | <primary>
+			pushed = push_frame(ExprFrame::Kind::UNARY, Precedence::UNARY);
+		} else if (match(TokenType::LEFT_PAREN)) {
+			// "(" <comma_expression> ")"
+			pushed = push_frame(ExprFrame::Kind::GROUPING, Precedence::COMMA);
+		} else {
+			return primary();
+		}
+		require_return_value(pushed, Operand{});
 	}
-	return expr;
 }
 
 // =====================================================================================================================
 
-// <factor> -> <unary> ( ( "/" | "*" ) <unary> )*
-std::shared_ptr<Expr>
-Parser::factor() // NOLINT(misc-no-recursion)
-{
-	// Error handling for factor that does not have a left operand.
-	if (match(TokenType::SLASH, TokenType::STAR)) {
-		const Token& mul_opr = previous();
-		error(mul_opr, "Expect left operand before factor operator.");
-		// Parse the right operand and continue parsing.
-		std::shared_ptr<Expr> right = unary();
-		return right;
-	}
+/*
+ *	@brief
+ *		Hands a complete `operand` to the innermost frame and parses the operators that follow it, finishing frames
+ *		as far as it can. Returns false when an operator needs another operand, for which a frame has been opened;
+ *		true once the outermost expression is complete, and left in `operand`, or has failed, leaving it null.
+ */
+bool
+Parser::parse_infix(Operand& operand)
+{
+	while (true) {
+		ExprFrame& frame = m_frames.back();
+		if (frame.kind == ExprFrame::Kind::UNARY) {
+			operand = Operand{make_node<Unary>(frame.opr, operand.expr), operand.height + 1};
+			require_action_return_value(check_depth(operand.height, frame.opr), operand = Operand{}, true);
+			m_frames.pop_back();
+			continue;
+		}
 
-	std::shared_ptr<Expr> expr = unary();
-	while (match(TokenType::SLASH, TokenType::STAR)) {
-		const Token& mul_opr = previous();
-		std::shared_ptr<Expr> right = unary();
-		expr = std::make_shared<Binary>(expr, mul_opr, right);
+		const TokenType opr_type = frame.opr.get_type();
+		if (frame.left.expr == nullptr) {
+			frame.left = std::move(operand);
+		} else if (opr_type == TokenType::QUESTION && frame.then_branch.expr == nullptr) {
+			// <conditional_expression> -> <expression> "?" <expression> ":" <conditional_expression>
+			frame.then_branch = std::move(operand);
+			const bool pushed = consume(TokenType::COLON, "Expect ':' after expression.") &&
+				push_frame(ExprFrame::Kind::OPERATORS, Precedence::CONDITIONAL);
+			require_action_return_value(pushed, operand = Operand{}, true);
+			return false;
+		} else if (opr_type == TokenType::QUESTION) {
+			const size_t height = 1 + std::max({frame.left.height, frame.then_branch.height, operand.height});
+			require_action_return_value(check_depth(height, frame.opr), operand = Operand{}, true);
+			frame.left = Operand{
+				make_node<Ternary>(frame.left.expr, frame.opr, frame.then_branch.expr, previous(), operand.expr),
+				height};
+			frame.then_branch = Operand{};
+			frame.limit = Precedence::CONDITIONAL;
+		} else if (opr_type == TokenType::EQUAL) {
+			// <assignment> -> IDENTIFIER "=" <assignment>
+			if (frame.left.expr->kind() == ExprKind::VARIABLE) {
+				const Token& name = static_cast<const Variable&>(*frame.left.expr).get_name();
+				frame.left = Operand{make_node<Assign>(name, operand.expr), operand.height + 1};
+				require_action_return_value(check_depth(frame.left.height, frame.opr), operand = Operand{}, true);
+			} else {
+				error(frame.opr, "Invalid assignment target.");
+			}
+			frame.limit = Precedence::ASSIGNMENT;
+		} else {
+			// A binary operator's rule loops, so operators at its own level may follow it. A chain like `a + b + c`
+			// does not nest, so only its right operands count toward its depth, not its length.
+			const size_t height = std::max(frame.left.height, operand.height + 1);
+			require_action_return_value(check_depth(height, frame.opr), operand = Operand{}, true);
+			frame.left = Operand{make_node<Binary>(frame.left.expr, frame.opr, operand.expr), height};
+			frame.limit = next_tighter(parse_rule(opr_type).infix);
+		}
+
+		// Only the operators that the grammar rule this frame has returned to, or a looser one, accepts may follow.
+		const Precedence precedence = parse_rule(peek().get_type()).infix;
+		if (precedence >= frame.lowest && precedence < frame.limit) {
+			advance();
+			frame.opr = previous();
+			// The conditional operator's middle operand and the assigned value are expressions of their own.
+			const bool nests = precedence == Precedence::CONDITIONAL || precedence == Precedence::ASSIGNMENT;
+			const Precedence operand_lowest = nests ? Precedence::ASSIGNMENT : next_tighter(precedence);
+			require_action_return_value(
+				push_frame(ExprFrame::Kind::OPERATORS, operand_lowest), operand = Operand{}, true);
+			return false;
+		}
+
+		operand = std::move(frame.left);
+		if (frame.kind == ExprFrame::Kind::GROUPING) {
+			require_action_return_value(
+				consume(TokenType::RIGHT_PAREN, "Expect ')' after expression."), operand = Operand{}, true);
+			operand = Operand{make_node<Grouping>(operand.expr), operand.height + 1};
+			require_action_return_value(check_depth(operand.height, previous()), operand = Operand{}, true);
+		}
+		m_frames.pop_back();
+		require_return_value(!m_frames.empty(), true);
 	}
-	return expr;
 }
 
 // =====================================================================================================================
 
-// <unary> -> ( "!" | "-" ) <unary> | <primary>
-std::shared_ptr<Expr>
-Parser::unary() // NOLINT(misc-no-recursion)
+bool
+Parser::push_frame(const ExprFrame::Kind kind, const Precedence lowest)
 {
-	if (match(TokenType::BANG, TokenType::MINUS)) {
-		const Token& unary_opr = previous();
-		std::shared_ptr<Expr> right = unary();
-		return std::make_shared<Unary>(unary_opr, right);
-	}
-	return primary();
+	// Nearly every frame adds a level to the tree, so this bounds the frames before their nodes are built.
+	require_return_value(check_depth(m_frames.size() + 1, previous()), false);
+	ExprFrame& frame = m_frames.emplace_back();
+	frame.kind = kind;
+	frame.lowest = lowest;
+	frame.opr = previous();
+	return true;
 }
 
 // =====================================================================================================================
 
-// <primary> -> NUMBER | STRING | "true" | "false" | "nil" | "(" <comma_expression> ")"
-std::shared_ptr<Expr>
-Parser::primary() // NOLINT(misc-no-recursion)
+// <primary> -> NUMBER | STRING | "true" | "false" | "nil" | IDENTIFIER
+Parser::Operand
+Parser::primary()
 {
 	if (match(TokenType::FALSE)) {
-		return std::make_shared<Literal>(Value(false));
+		return Operand{make_node<Literal>(Value(false)), 1};
 	}
 	if (match(TokenType::TRUE)) {
-		return std::make_shared<Literal>(Value(true));
+		return Operand{make_node<Literal>(Value(true)), 1};
 	}
 	if (match(TokenType::NIL)) {
-		return std::make_shared<Literal>(Value());
+		return Operand{make_node<Literal>(Value()), 1};
 	}
-	if (match(TokenType::NUMBER, TokenType::STRING)) {
-		return std::make_shared<Literal>(previous().get_literal());
+	if (match(literal_tokens)) {
+		return Operand{make_node<Literal>(std::move(m_literals[(current - 1) % ring_size])), 1};
 	}
 	if (match(TokenType::IDENTIFIER)) {
-		return std::make_shared<Variable>(previous());
-	}
-	if (match(TokenType::LEFT_PAREN)) {
-		std::shared_ptr<Expr> comma_expr = comma_expression();
-		consume(TokenType::RIGHT_PAREN, "Expect ')' after expression.");
-		return std::make_shared<Grouping>(comma_expr);
+		return Operand{make_node<Variable>(previous()), 1};
 	}
 
-	throw error(peek(), "Expect expression.");
+	error(peek(), "Expect expression.");
+	return Operand{};
+}
+
+// =====================================================================================================================
+
+// Reports `token` and returns false if a subtree of `height` inside the open blocks would be deeper than allowed.
+bool
+Parser::check_depth(const size_t height, const Token& token)
+{
+	require_return_value(m_blocks.size() + height > m_max_depth, true);
+	error(token, std::format("Nesting exceeds the maximum depth of {}.", m_max_depth));
+	m_depth_exceeded = true;
+	return false;
 }
 
 // =====================================================================================================================
@@ -273,17 +379,49 @@ Parser::primary() // NOLINT(misc-no-recursion)
 // =======================================================================================================
 // declaration -> variable_declaration | statement
 
+/*
+ *	@brief
+ *		Parses a declaration. A block is opened on `m_blocks` rather than parsed by a nested call, and the
+ *		declarations in it are parsed by this same loop.
+ *
+ *		The rules below return null once they have reported a syntax error, without examining any further tokens.
+ *		The parser then resynchronizes, and the failed declaration is left out of the innermost open block, which
+ *		goes on with the next one; at the top level, null is returned.
+ */
 std::shared_ptr<Stmt>
-Parser::declaration() // NOLINT(misc-no-recursion)
+Parser::declaration()
 {
-	try {
-		if (match(TokenType::VAR)) {
-			return variable_declaration();
+	m_blocks.clear();
+	m_depth_exceeded = false;
+	while (true) {
+		std::shared_ptr<Stmt> parsed;
+		if (!m_blocks.empty() && (check(TokenType::RIGHT_BRACE) || is_at_end())) {
+			parsed = close_block();
+		} else {
+			if (match(TokenType::VAR)) {
+				parsed = variable_declaration();
+			} else if (match(TokenType::LEFT_BRACE)) {
+				m_blocks.emplace_back();
+				if (check_depth(0, previous())) {
+					continue;
+				}
+			} else {
+				parsed = statement();
+			}
+			if (parsed == nullptr) {
+				m_frames.clear();
+				// Whatever follows a depth error is nested at least as deeply, so the rest of its declaration is
+				// skipped rather than reported again.
+				if (m_depth_exceeded && !m_blocks.empty()) {
+					skip_open_blocks();
+				} else {
+					synchronize();
+				}
+			}
+		}
+		if (add_to_block(parsed)) {
+			return parsed;
 		}
-		return statement();
-	} catch (UNUSED const ParserError& error) {
-		synchronize();
-		return nullptr;
 	}
 }
 
@@ -293,27 +431,27 @@ Parser::declaration() // NOLINT(misc-no-recursion)
 std::shared_ptr<Stmt>
 Parser::variable_declaration()
 {
-	const Token& name = consume(TokenType::IDENTIFIER, "Expect variable name.");
+	require_return_value(consume(TokenType::IDENTIFIER, "Expect variable name."), nullptr);
+	const Token name = previous();
 	std::shared_ptr<Expr> initializer = nullptr;
 	if (match(TokenType::EQUAL)) {
 		initializer = comma_expression();
+		require_return_value(initializer != nullptr, nullptr);
 	}
-	consume(TokenType::SEMICOLON, "Expect ';' after variable declaration.");
-	return std::make_shared<Var>(name, initializer);
+	require_return_value(consume(TokenType::SEMICOLON, "Expect ';' after variable declaration."), nullptr);
+	return make_node<Var>(name, initializer);
 }
 
 // =====================================================================================================================
 // statement	-> <expr_stmt> | <print_stmt>
 
+// Blocks are statements too, but are opened by `declaration`.
 std::shared_ptr<Stmt>
-Parser::statement() // NOLINT(misc-no-recursion)
+Parser::statement()
 {
 	if (match(TokenType::PRINT)) {
 		return print_statement();
 	}
-	if (match(TokenType::LEFT_BRACE)) {
-		return std::make_shared<Block>(block());
-	}
 	return expression_statement();
 }
 
@@ -323,11 +461,12 @@ std::shared_ptr<Stmt>
 Parser::expression_statement()
 {
 	std::shared_ptr<Expr> expr = expression();
+	require_return_value(expr != nullptr, nullptr);
 	if (m_is_repl_mode && !check(TokenType::SEMICOLON)) {
-		return std::make_shared<ExpressionResult>(expr);
+		return make_node<ExpressionResult>(expr);
 	}
-	consume(TokenType::SEMICOLON, "Expect ';' after expression.");
-	return std::make_shared<Expression>(expr);
+	require_return_value(consume(TokenType::SEMICOLON, "Expect ';' after expression."), nullptr);
+	return make_node<Expression>(expr);
 }
 
 // =====================================================================================================================
@@ -336,50 +475,100 @@ std::shared_ptr<Stmt>
 Parser::print_statement()
 {
 	std::shared_ptr<Expr> expr = expression();
-	consume(TokenType::SEMICOLON, "Expect ';' after expression.");
-	return std::make_shared<Print>(expr);
+	require_return_value(expr != nullptr, nullptr);
+	require_return_value(consume(TokenType::SEMICOLON, "Expect ';' after expression."), nullptr);
+	return make_node<Print>(expr);
 }
 
 // =====================================================================================================================
 // block -> "{" <declaration>* "}"
-std::vector<std::shared_ptr<const Stmt>>
-Parser::block() // NOLINT(misc-no-recursion)
+
+// Closes the innermost open block at its closing brace; if there is none, the block statement fails.
+std::shared_ptr<Stmt>
+Parser::close_block()
 {
-	std::vector<std::shared_ptr<const Stmt>> statements;
-	while (!check(TokenType::RIGHT_BRACE) && !is_at_end()) {
-		// Get the statement from declaration
-		std::shared_ptr<const Stmt> statement = declaration();
+	std::vector<std::shared_ptr<const Stmt>> statements = std::move(m_blocks.back());
+	m_blocks.pop_back();
+	if (!check(TokenType::RIGHT_BRACE)) {
+		error(peek(), "Expect '}' after block.");
+		synchronize();
+		return nullptr;
+	}
+	advance();
+	return make_node<Block>(std::move(statements));
+}
 
-		if (statement != nullptr) {
-			// Check if this statement is an ExpressionResult (expression without semicolon in REPL mode)
-			auto expr_result = std::dynamic_pointer_cast<const ExpressionResult>(statement);
+// =====================================================================================================================
 
-			// If it's an ExpressionResult, ensure it's the last statement in the block
-			if (expr_result && !check(TokenType::RIGHT_BRACE)) {
-				// Not the last statement in the block, so this should have had a semicolon
-				throw error(previous(), "Expect ';' after expression.");
-			}
+/*
+ *	@brief
+ *		Adds a parsed statement, or null for one that failed, to the innermost open block. Returns true if no block is
+ *		open, so that `statement` is the whole declaration.
+ */
+bool
+Parser::add_to_block(std::shared_ptr<Stmt>& statement)
+{
+	require_return_value(!m_blocks.empty(), true);
+
+	// An ExpressionResult (expression without semicolon in REPL mode) must be the last statement in the block
+	const bool is_expr_result = statement != nullptr && statement->kind() == StmtKind::EXPRESSIONRESULT;
+	if (is_expr_result && !check(TokenType::RIGHT_BRACE)) {
+		// Not the last statement in the block, so this should have had a semicolon. The block statement fails.
+		error(previous(), "Expect ';' after expression.");
+		m_blocks.pop_back();
+		synchronize();
+		statement = nullptr;
+		return m_blocks.empty();
+	}
 
-			statements.push_back(statement);
+	if (statement != nullptr) {
+		m_blocks.back().push_back(std::move(statement));
+	}
+	return false;
+}
+
+// =====================================================================================================================
+
+// Discards the open blocks, and skips the tokens up to the closing brace of the outermost one or the end of the input.
+void
+Parser::skip_open_blocks()
+{
+	size_t open_blocks = m_blocks.size();
+	m_blocks.clear();
+	while (open_blocks > 0 && !is_at_end()) {
+		if (match(TokenType::LEFT_BRACE)) {
+			++open_blocks;
+		} else if (match(TokenType::RIGHT_BRACE)) {
+			--open_blocks;
+		} else {
+			advance();
 		}
 	}
-	consume(TokenType::RIGHT_BRACE, "Expect '}' after block.");
-	return statements;
 }
 
 // =====================================================================================================================
 // Helper methods.
 
+
 // =====================================================================================================================
 
-ParserError::~ParserError() = default;
+bool
+Parser::match(const TokenType type)
+{
+	require_return_value(check(type), false);
+	advance();
+	return true;
+}
 
 // =====================================================================================================================
 
-const std::vector<Token>&
-Parser::get_tokens() const
+bool
+Parser::match(const TokenSet types)
 {
-	return m_tokens;
+	m_lookahead = std::max(m_lookahead, current);
+	require_return_value(types.contains(m_ring[current % ring_size].get_type()), false);
+	advance();
+	return true;
 }
 
 // =====================================================================================================================
@@ -389,18 +578,33 @@ Parser::advance()
 {
 	if (!is_at_end()) {
 		current++;
+		pull();
 	}
 	return previous();
 }
 
 // =====================================================================================================================
 
-Token
-Parser::consume(const TokenType type, const std::string& message)
+void
+Parser::pull()
 {
-	const bool consumed = check(type);
-	require_throw(consumed, error(peek(), message));
-	return advance();
+	const size_t slot = current % ring_size;
+	m_ring[slot] = m_scanner->next_token();
+	const TokenType type = m_ring[slot].get_type();
+	if (type == TokenType::NUMBER || type == TokenType::STRING) {
+		m_literals[slot] = m_scanner->take_literal();
+	}
+}
+
+// =====================================================================================================================
+
+// Consumes a token of `type`, or reports `message` at the current token and returns false.
+bool
+Parser::consume(const TokenType type, const std::string_view message)
+{
+	require_action_return_value(check(type), error(peek(), message), false);
+	advance();
+	return true;
 }
 
 // =====================================================================================================================
@@ -410,11 +614,11 @@ Parser::synchronize()
 {
 	advance();
 	while (!is_at_end()) {
-		if (previous().get_type() == TokenType::SEMICOLON) {
+		if (m_ring[(current - 1) % ring_size].get_type() == TokenType::SEMICOLON) {
 			return;
 		}
 		ignore_warning_begin("-Wswitch-enum");
-		switch (peek().get_type()) {
+		switch (m_ring[current % ring_size].get_type()) {
 		case TokenType::CLASS:
 		case TokenType::FOR:
 		case TokenType::FUN:
@@ -435,33 +639,24 @@ bool
 Parser::check(const TokenType type) const
 {
 	require_return_value(!is_at_end(), false);
-	const Token& token = peek();
-	return token.get_type() == type;
+	return m_ring[current % ring_size].get_type() == type;
 }
 
 // =====================================================================================================================
 
-bool
-Parser::is_at_end() const
-{
-	const Token& token = peek();
-	return token.get_type() == TokenType::END_OF_FILE;
-}
-
-// =====================================================================================================================
-
-const Token&
+Token
 Parser::peek() const
 {
-	return get_tokens().at(current);
+	m_lookahead = std::max(m_lookahead, current);
+	return m_ring[current % ring_size];
 }
 
 // =====================================================================================================================
 
-const Token&
+Token
 Parser::previous() const
 {
-	return get_tokens().at(current - 1);
+	return m_ring[(current - 1) % ring_size];
 }
 
 // =====================================================================================================================
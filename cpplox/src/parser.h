@@ -1,37 +1,146 @@
 #ifndef PARSER_H
 #define PARSER_H
 
-#include <algorithm>
-#include <concepts>
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <memory_resource>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 #include "asts/expr.h"
 #include "asts/stmt.h"
 #include "general.h"
+#include "scanner.h"
 #include "token.h"
 #include "token_type.h"
+#include "value.h"
+
+/*
+ *	@brief
+ *		Binding power of the expression grammar's levels, loosest first. Binary operators at a level take operands of
+ *		the next level; `PRIMARY` is above every operator.
+ */
+enum class Precedence : std::uint8_t
+{
+	NONE,
+	COMMA,		 // ,
+	CONDITIONAL, // ?:
+	ASSIGNMENT,	 // =
+	EQUALITY,	 // == !=
+	COMPARISON,	 // > >= < <=
+	TERM,		 // + -
+	FACTOR,		 // * /
+	UNARY,		 // ! -
+	PRIMARY,
+};
 
 class Parser
 {
 public:
-	template <typename T_TokenVector>
-		requires std::convertible_to<T_TokenVector, std::vector<Token>>
-	explicit Parser(T_TokenVector&& tokens, const bool is_repl_mode)
-		: m_tokens(std::forward<T_TokenVector>(tokens)), m_is_repl_mode(is_repl_mode)
-	{
-		// Empty constructor.
-	}
+	/*
+	 *	@brief
+	 *		Pulls its tokens from `scanner`, which must outlive the parser. The syntax tree's nodes are allocated from
+	 *		`resource`, which must outlive them.
+	 */
+	explicit Parser(Scanner& scanner, bool is_repl_mode,
+		std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
+	/*
+	 *	@brief
+	 *		Parses the whole input. Syntax errors are reported through `Lox::error` and never thrown; the declarations
+	 *		they occur in are left out. In REPL mode, an expression without a semicolon that is not the last statement
+	 *		rejects the input as a whole, and nothing is returned.
+	 */
 	std::vector<std::shared_ptr<Stmt>> parse();
 
+	/*
+	 *	@brief
+	 *		Parses the next top-level declaration only, for callers that track declarations individually. Returns null
+	 *		if the declaration had a syntax error; the parser has then already resynchronized.
+	 */
+	std::shared_ptr<Stmt> parse_declaration();
+
+	[[nodiscard]] bool is_at_end() const;
+
+	// Index of the next token to be consumed.
+	[[nodiscard]] size_t get_position() const;
+
+	// Index of the furthest token examined since the last `parse_declaration` began.
+	[[nodiscard]] size_t get_lookahead() const;
+
+	/*
+	 *	@brief
+	 *		Deepest syntax tree accepted, counting enclosing blocks and the nesting of the expression within them; a
+	 *		declaration that goes deeper is reported as a single parse error and left out. The parser keeps its own
+	 *		state on the heap, and the tree is evaluated and destroyed without recursing, so how deeply an expression
+	 *		nests costs no native stack. Blocks are still executed recursively: with an 8 MiB stack, they overflow at
+	 *		about 30,000 levels in an unoptimized build and 60,000 in an optimized one. `set_max_depth` clamps to
+	 *		`max_safe_depth`, below both, and the default stays well below that.
+	 */
+	static constexpr size_t default_max_depth = 10'000;
+	static constexpr size_t max_safe_depth = 20'000;
+	void set_max_depth(size_t max_depth);
+
 private:
-	std::vector<Token> m_tokens;
+	// The parser looks at most one token ahead, so besides the current token only the previous one is kept. Token
+	// `index` and its literal, if it has one, live in slot `index % ring_size`.
+	static constexpr size_t ring_size = 2;
+
+	// An expression and the height of its syntax tree.
+	struct Operand {
+		std::shared_ptr<Expr> expr;
+		size_t height = 0;
+	};
+
+	/*
+	 *	@brief
+	 *		An expression that `parse_expression` has started and that is waiting for an operand. An `OPERATORS` frame
+	 *		parses binary operators of level `lowest` up to `limit`: `left` is its expression so far and `opr` the
+	 *		operator whose right operand is being parsed, if any. A `GROUPING` frame is the same inside parentheses. A
+	 *		`UNARY` frame is waiting for the operand of `opr`.
+	 */
+	struct ExprFrame {
+		enum class Kind : std::uint8_t
+		{
+			OPERATORS,
+			GROUPING,
+			UNARY,
+		};
+
+		Kind kind = Kind::OPERATORS;
+		Precedence lowest = Precedence::NONE;
+		Precedence limit = Precedence::PRIMARY;
+		CLASS_PADDING(5);
+		Token opr = Token(TokenType::END_OF_FILE, 0);
+		Operand left;
+		Operand then_branch; // The conditional operator's middle operand, once parsed.
+	};
+
+	Scanner* m_scanner;
+	std::pmr::polymorphic_allocator<> m_allocator;
+	std::array<Token, ring_size> m_ring;
+	std::array<Value, ring_size> m_literals;
+	// Expressions and blocks being parsed, innermost last. Both are reused, so nesting costs no native stack.
+	std::vector<ExprFrame> m_frames;
+	std::vector<std::vector<std::shared_ptr<const Stmt>>> m_blocks;
 	size_t current = 0;
+	mutable size_t m_lookahead = 0;
+	size_t m_max_depth = default_max_depth;
 	bool m_is_repl_mode = false;
-	CLASS_PADDING(7);
+	// Set when `check_depth` reports an error, so that the declaration it occurred in is skipped as a whole.
+	bool m_depth_exceeded = false;
+	CLASS_PADDING(6);
 
-	[[nodiscard]] const std::vector<Token>& get_tokens() const;
+	// Allocates a node, and its reference count, from the parser's memory resource.
+	template <typename T_Node, typename... T_Args>
+	std::shared_ptr<T_Node>
+	make_node(T_Args&&... args)
+	{
+		return std::allocate_shared<T_Node>(m_allocator, std::forward<T_Args>(args)...);
+	}
 
 	/*
 	 * Expression grammar:
@@ -51,18 +160,19 @@ private:
 	 * primary					-> NUMBER | STRING | "true" | "false" | "nil"
 	 *							| "(" comma_expression ")"
 	 *							| IDENTIFIER;
+	 *
+	 * All of it is parsed by `parse_expression`, which looks up each operator's level in a table instead of descending
+	 * through one function per level, and keeps the expressions it has started in `m_frames`.
 	 */
 
 	std::shared_ptr<Expr> comma_expression();
-	std::shared_ptr<Expr> conditional_expression();
 	std::shared_ptr<Expr> expression();
-	std::shared_ptr<Expr> assignment();
-	std::shared_ptr<Expr> equality();
-	std::shared_ptr<Expr> comparison();
-	std::shared_ptr<Expr> term();
-	std::shared_ptr<Expr> factor();
-	std::shared_ptr<Expr> unary();
-	std::shared_ptr<Expr> primary();
+	std::shared_ptr<Expr> parse_expression(Precedence lowest);
+	Operand parse_prefix();
+	bool parse_infix(Operand& operand);
+	[[nodiscard]] bool push_frame(ExprFrame::Kind kind, Precedence lowest);
+	Operand primary();
+	[[nodiscard]] bool check_depth(size_t height, const Token& token);
 
 	/*
 	 * Statement grammar:
@@ -77,6 +187,8 @@ private:
 	 * expression_statement		-> expression ";" ;
 	 * print_statement			-> "print" expression ";" ;
 	 * block					-> "{" declaration* "}" ;
+	 *
+	 * `declaration` keeps the blocks it has opened in `m_blocks` instead of recursing into them.
 	 */
 
 	std::shared_ptr<Stmt> declaration();
@@ -84,28 +196,22 @@ private:
 	std::shared_ptr<Stmt> statement();
 	std::shared_ptr<Stmt> expression_statement();
 	std::shared_ptr<Stmt> print_statement();
-	std::vector<std::shared_ptr<const Stmt>> block();
+	std::shared_ptr<Stmt> close_block();
+	bool add_to_block(std::shared_ptr<Stmt>& statement);
+	void skip_open_blocks();
 
-	template <typename... VT_TokenType>
-		requires((std::is_same_v<VT_TokenType, TokenType>) && ...)
-	bool match(VT_TokenType... types)
-	{
-		std::initializer_list<TokenType> token_types = {types...};
-		const auto it = std::ranges::find_if(token_types, [this](const TokenType& type) { return check(type); });
-		require_return_value(it != token_types.end(), false);
-
-		advance();
-		return true;
-	}
+	// Consumes the current token if it has the given type, or one of the types in the given set.
+	bool match(TokenType type);
+	bool match(TokenSet types);
 
 	Token advance();
-	Token consume(TokenType type, const std::string& message);
+	void pull();
+	[[nodiscard]] bool consume(TokenType type, std::string_view message);
 	void synchronize();
 
 	[[nodiscard]] bool check(TokenType type) const;
-	[[nodiscard]] bool is_at_end() const;
-	[[nodiscard]] const Token& peek() const;
-	[[nodiscard]] const Token& previous() const;
+	[[nodiscard]] Token peek() const;
+	[[nodiscard]] Token previous() const;
 };
 
 #endif // PARSER_H
@@ -1,31 +1,284 @@
 #include "scanner.h"
 
 #include <algorithm>
+#include <array>
+#include <charconv>
 #include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
+#include <optional>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
 #include <vector>
 
 #include "general.h"
 #include "lox.h"
 #include "token.h"
+#include "token_stream.h"
 #include "token_type.h"
+#include "utilities/scan_kernels.h"
 #include "value.h"
 
+namespace {
+
+// =====================================================================================================================
+// Lexer tables, built at compile time from the punctuator spellings in token_type.h.
+
+enum class CharClass : std::uint8_t
+{
+	INVALID,
+	WHITESPACE, // ' ', '\t', '\r', '\n'
+	SLASH, // Division or the start of a comment.
+	QUOTE,
+	PUNCTUATOR,
+	DIGIT,
+	ALPHA, // Letters and '_'.
+};
+
+// How a punctuator starting with a given character is completed.
+struct OperatorTransition {
+	TokenType single = TokenType::END_OF_FILE; // The token for the character on its own.
+	TokenType pair = TokenType::END_OF_FILE;   // The token when followed by `second`.
+	char second = '\0';					   // '\0' if no two-character token starts with this character.
+};
+
+constexpr size_t byte_count = 256;
+
+constexpr size_t
+byte_index(const char ch) // NOLINT(readability-identifier-length)
+{
+	return static_cast<unsigned char>(ch);
+}
+
+consteval std::array<OperatorTransition, byte_count>
+make_operator_table()
+{
+	std::array<OperatorTransition, byte_count> table{};
+	for (size_t index = 0; index < token_type_count; ++index) {
+		const auto type = static_cast<TokenType>(index);
+		const std::string_view spelling = punctuator_spelling(type);
+		if (spelling.size() == 1) {
+			table[byte_index(spelling[0])].single = type;
+		} else if (spelling.size() == 2) {
+			table[byte_index(spelling[0])].pair = type;
+			table[byte_index(spelling[0])].second = spelling[1];
+		}
+	}
+	return table;
+}
+
+constexpr std::array<OperatorTransition, byte_count> operator_table = make_operator_table();
+
+consteval std::array<CharClass, byte_count>
+make_char_classes()
+{
+	std::array<CharClass, byte_count> classes{};
+	for (size_t index = 0; index < byte_count; ++index) {
+		if (operator_table[index].single != TokenType::END_OF_FILE) {
+			classes[index] = CharClass::PUNCTUATOR;
+		}
+	}
+	for (char ch = '0'; ch <= '9'; ++ch) { // NOLINT(readability-identifier-length)
+		classes[byte_index(ch)] = CharClass::DIGIT;
+	}
+	for (char ch = 'a'; ch <= 'z'; ++ch) { // NOLINT(readability-identifier-length)
+		classes[byte_index(ch)] = CharClass::ALPHA;
+		classes[byte_index(static_cast<char>(ch - 'a' + 'A'))] = CharClass::ALPHA;
+	}
+	classes[byte_index('_')] = CharClass::ALPHA;
+	classes[byte_index(' ')] = CharClass::WHITESPACE;
+	classes[byte_index('\t')] = CharClass::WHITESPACE;
+	classes[byte_index('\r')] = CharClass::WHITESPACE;
+	classes[byte_index('\n')] = CharClass::WHITESPACE;
+	classes[byte_index('"')] = CharClass::QUOTE;
+	classes[byte_index('/')] = CharClass::SLASH;
+	return classes;
+}
+
+constexpr std::array<CharClass, byte_count> char_classes = make_char_classes();
+
+constexpr CharClass
+char_class(const char ch) // NOLINT(readability-identifier-length)
+{
+	return char_classes[byte_index(ch)];
+}
+
+// Every punctuator must be reachable through the tables: a two-character token's first character has to be a token
+// on its own, and no two two-character tokens may share a first character.
+consteval bool
+operator_table_covers_punctuators()
+{
+	for (size_t index = 0; index < token_type_count; ++index) {
+		const auto type = static_cast<TokenType>(index);
+		const std::string_view spelling = punctuator_spelling(type);
+		if (spelling.empty()) {
+			continue;
+		}
+		const OperatorTransition& transition = operator_table[byte_index(spelling[0])];
+		if (spelling.size() == 1 && transition.single != type) {
+			return false;
+		}
+		if (spelling.size() == 2 && (transition.pair != type || transition.single == TokenType::END_OF_FILE)) {
+			return false;
+		}
+		if (spelling.size() > 2) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static_assert(operator_table_covers_punctuators());
+static_assert(char_class('/') == CharClass::SLASH && operator_table[byte_index('/')].single == TokenType::SLASH);
+static_assert(char_class('=') == CharClass::PUNCTUATOR && operator_table[byte_index('=')].second == '=');
+static_assert(char_class('@') == CharClass::INVALID);
+
+// =====================================================================================================================
+// Skimming helpers for finding chunk boundaries. They mirror how the scanner treats strings and comments.
+
+// Skips a (possibly nested) block comment whose opening "/*" ends right before `pos`.
+size_t
+skim_block_comment(const std::string_view source, size_t pos)
+{
+	size_t depth = 1;
+	while (depth > 0) {
+		pos = scan_kernels::find_comment_delimiter(source, pos);
+		if (pos >= source.size()) {
+			return source.size();
+		}
+		depth = source[pos] == '/' ? depth + 1 : depth - 1;
+		pos += 2;
+	}
+	return pos;
+}
+
+// Returns the first '\n' at or after `target` that lies between tokens, starting from `pos`, which must lie between
+// tokens too; returns `source.size()` if there is none.
+size_t
+skim_to_line_break(const std::string_view source, size_t pos, const size_t target)
+{
+	size_t line_break = scan_kernels::find_line_end(source, std::max(pos, target));
+	while (pos < source.size()) {
+		const size_t special = scan_kernels::find_quote_or_slash(source, pos);
+		if (line_break < special || special >= source.size()) {
+			return line_break;
+		}
+		pos = special + 1;
+		if (source[special] == '"') {
+			pos = scan_kernels::find_string_end(source, pos);
+			pos = std::min(pos + 1, source.size());
+		} else if (pos < source.size() && source[pos] == '/') {
+			pos = scan_kernels::find_line_end(source, pos);
+		} else if (pos < source.size() && source[pos] == '*') {
+			pos = skim_block_comment(source, pos + 1);
+		}
+		if (line_break < pos) {
+			line_break = scan_kernels::find_line_end(source, std::max(pos, target));
+		}
+	}
+	return source.size();
+}
+
+} // namespace
+
+// =====================================================================================================================
+// Compile-time checks of the keyword classifier.
+
+static_assert(identifier_type("and") == TokenType::AND);
+static_assert(identifier_type("class") == TokenType::CLASS);
+static_assert(identifier_type("else") == TokenType::ELSE);
+static_assert(identifier_type("false") == TokenType::FALSE);
+static_assert(identifier_type("for") == TokenType::FOR);
+static_assert(identifier_type("fun") == TokenType::FUN);
+static_assert(identifier_type("if") == TokenType::IF);
+static_assert(identifier_type("nil") == TokenType::NIL);
+static_assert(identifier_type("or") == TokenType::OR);
+static_assert(identifier_type("print") == TokenType::PRINT);
+static_assert(identifier_type("return") == TokenType::RETURN);
+static_assert(identifier_type("super") == TokenType::SUPER);
+static_assert(identifier_type("this") == TokenType::THIS);
+static_assert(identifier_type("true") == TokenType::TRUE);
+static_assert(identifier_type("var") == TokenType::VAR);
+static_assert(identifier_type("while") == TokenType::WHILE);
+static_assert(identifier_type("fan") == TokenType::IDENTIFIER);
+static_assert(identifier_type("thus") == TokenType::IDENTIFIER);
+static_assert(identifier_type("returns") == TokenType::IDENTIFIER);
+static_assert(identifier_type("x") == TokenType::IDENTIFIER);
+
 // =====================================================================================================================
 // Public methods.
 
-Scanner::Scanner(std::string source) : m_source(std::move(source))
+Scanner::Scanner(std::string_view source, const ScanMode mode, std::pmr::memory_resource* const resource)
+	: m_source(source), m_tokens(source, resource), m_symbols(&SymbolTable::global()),
+	  m_defer_errors(mode == ScanMode::ON_DEMAND), m_on_demand(mode == ScanMode::ON_DEMAND)
 {
-	scan_tokens();
+	require_return(!m_on_demand);
+
+	const size_t chunk_count = mode == ScanMode::PARALLEL ? parallel_chunk_count(source.size()) : 1;
+	if (chunk_count > 1) {
+		scan_parallel(chunk_count);
+	} else {
+		scan_tokens();
+	}
+	m_tokens.push_back(TokenType::END_OF_FILE, m_current, 0);
 }
 
-const std::vector<Token>&
+const TokenStream&
 Scanner::get_tokens() const
 {
 	return m_tokens;
 }
 
+Token
+Scanner::next_token()
+{
+	if (m_on_demand) {
+		m_tokens.clear();
+		while (m_tokens.size() == 0 && !is_at_end()) {
+			m_start = m_current;
+			scan_token();
+		}
+		if (m_tokens.size() == 0) {
+			m_tokens.push_back(TokenType::END_OF_FILE, m_current, 0);
+		}
+		return m_tokens.get_token(0);
+	}
+
+	m_last_token = m_next_token;
+	if (m_next_token + 1 < m_tokens.size()) {
+		m_next_token++;
+	}
+	return m_tokens.get_token(m_last_token);
+}
+
+Value
+Scanner::take_literal()
+{
+	return m_on_demand ? m_tokens.take_literal(0) : m_tokens.get_literal(m_last_token);
+}
+
+void
+Scanner::finish()
+{
+	if (m_on_demand) {
+		while (!is_at_end()) {
+			m_tokens.clear();
+			m_start = m_current;
+			scan_token();
+		}
+	}
+
+	m_defer_errors = false;
+	for (const DeferredError& deferred : m_deferred_errors) {
+		Lox::error(deferred.offset, deferred.message);
+	}
+	m_deferred_errors.clear();
+}
+
 void
 Scanner::scan_tokens()
 {
@@ -33,13 +286,105 @@ Scanner::scan_tokens()
 		m_start = m_current;
 		scan_token();
 	}
-	m_tokens.emplace_back(TokenType::END_OF_FILE, m_line);
 }
 
 // =====================================================================================================================
 // Private methods.
 
-std::string
+Scanner::Scanner(std::string_view source, const size_t begin, SymbolTable& symbols)
+	: m_source(source), m_tokens(source), m_symbols(&symbols), m_start(begin), m_current(begin), m_defer_errors(true)
+{
+	scan_tokens();
+}
+
+// =====================================================================================================================
+// Parallel scanning.
+
+void
+Scanner::scan_parallel(const size_t chunk_count)
+{
+	const std::vector<size_t> boundaries = find_chunk_boundaries(get_source(), chunk_count);
+	const size_t chunks = boundaries.size() - 1;
+
+	// Chunk 0 is scanned on this thread, the others on one worker thread each.
+	std::vector<std::optional<ChunkResult>> results(chunks);
+	{
+		std::vector<std::jthread> workers;
+		workers.reserve(chunks - 1);
+		for (size_t chunk = 1; chunk < chunks; ++chunk) {
+			workers.emplace_back([this, &results, &boundaries, chunk] {
+				results[chunk] = scan_chunk(get_source(), boundaries[chunk], boundaries[chunk + 1]);
+			});
+		}
+		results[0] = scan_chunk(get_source(), boundaries[0], boundaries[1]);
+	} // Joins the workers.
+
+	// Merge in source order, translating chunk-local symbols; errors are reported in the serial order.
+	size_t token_count = 1; // END_OF_FILE
+	size_t literal_count = 0;
+	for (const std::optional<ChunkResult>& result : results) {
+		token_count += result->tokens.size();
+		literal_count += result->tokens.literal_count();
+	}
+	m_tokens.reserve(token_count, literal_count);
+	for (std::optional<ChunkResult>& result : results) {
+		m_tokens.append(result->tokens, m_symbols->merge(result->symbols));
+		for (const DeferredError& deferred : result->errors) {
+			Lox::error(deferred.offset, deferred.message);
+		}
+		result.reset();
+	}
+	m_current = get_source().size();
+}
+
+Scanner::ChunkResult
+Scanner::scan_chunk(const std::string_view source, const size_t begin, const size_t end)
+{
+	SymbolTable symbols;
+	Scanner scanner(source.substr(0, end), begin, symbols);
+	return {std::move(scanner.m_tokens), std::move(symbols), std::move(scanner.m_deferred_errors)};
+}
+
+size_t
+Scanner::parallel_chunk_count(const size_t source_size)
+{
+	// Below this size a chunk is not worth a thread.
+	constexpr size_t min_chunk_size = 1024UL * 1024;
+	const size_t threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	return std::min(threads, source_size / min_chunk_size);
+}
+
+/*
+ *	@brief
+ *		Splits `source` into at most `chunk_count` chunks that can be scanned independently.
+ *
+ *		The source is skimmed with just enough state to know where strings and comments are, and each cut is placed
+ *		right after the first newline past the chunk's target offset that lies between tokens. No token spans such a
+ *		newline and the scanner is in its initial state after it. The skim only looks for '"', '/' and '\n', so it is
+ *		much cheaper than scanning.
+ *
+ *	@return
+ *		The chunk start offsets followed by `source.size()`.
+ */
+std::vector<size_t>
+Scanner::find_chunk_boundaries(const std::string_view source, const size_t chunk_count)
+{
+	std::vector<size_t> boundaries = {0};
+	size_t pos = 0;
+	for (size_t chunk = 1; chunk < chunk_count; ++chunk) {
+		const size_t target = std::max(pos, source.size() / chunk_count * chunk);
+		pos = skim_to_line_break(source, pos, target);
+		if (pos >= source.size()) {
+			break;
+		}
+		pos++; // Cut after the newline.
+		boundaries.push_back(pos);
+	}
+	boundaries.push_back(source.size());
+	return boundaries;
+}
+
+std::string_view
 Scanner::get_source() const
 {
 	return m_source;
@@ -55,32 +400,20 @@ void
 Scanner::scan_token()
 {
 	const char c = advance(); // NOLINT(readability-identifier-length)
-	switch (c) {
-	case '(': add_token(TokenType::LEFT_PAREN); break;
-	case ')': add_token(TokenType::RIGHT_PAREN); break;
-	case '{': add_token(TokenType::LEFT_BRACE); break;
-	case '}': add_token(TokenType::RIGHT_BRACE); break;
-	case ',': add_token(TokenType::COMMA); break;
-	case '.': add_token(TokenType::DOT); break;
-	case '-': add_token(TokenType::MINUS); break;
-	case '+': add_token(TokenType::PLUS); break;
-	case ':': add_token(TokenType::COLON); break;
-	case ';': add_token(TokenType::SEMICOLON); break;
-	case '?': add_token(TokenType::QUESTION); break;
-	case '*': add_token(TokenType::STAR); break;
-
-	// Two-character tokens.
-	case '!': add_token(match('=') ? TokenType::BANG_EQUAL : TokenType::BANG); break;
-	case '=': add_token(match('=') ? TokenType::EQUAL_EQUAL : TokenType::EQUAL); break;
-	case '<': add_token(match('=') ? TokenType::LESS_EQUAL : TokenType::LESS); break;
-	case '>': add_token(match('=') ? TokenType::GREATER_EQUAL : TokenType::GREATER); break;
-
-	// Longer tokens.
-	case '/': {
+	// clang-format off
+	ignore_warning_begin("-Wswitch-default");
+	// clang-format on
+	switch (char_class(c)) {
+	case CharClass::PUNCTUATOR: {
+		const OperatorTransition& transition = operator_table[byte_index(c)];
+		add_token(transition.second != '\0' && match(transition.second) ? transition.pair : transition.single);
+		break;
+	}
+
+	// Division or comments.
+	case CharClass::SLASH: {
 		if (match('/')) {
-			while (peek() != '\n' && !is_at_end()) {
-				advance();
-			}
+			m_current = scan_kernels::find_line_end(get_source(), m_current);
 		} else if (match('*')) {
 			skip_slash_star_comment();
 		} else {
@@ -90,38 +423,19 @@ Scanner::scan_token()
 	}
 
 	// Whitespace characters.
-	case ' ':
-	case '\r':
-	case '\t':
-		// Ignore whitespace characters.
+	case CharClass::WHITESPACE:
+		// Ignore the whole run of whitespace characters at once.
+		skip_whitespace();
 		break;
 
-	case '\n': m_line++; break;
-
 	// Literals.
-	// String literals.
-	case '"': add_string_literal(); break;
-
-	// Number literals.
-	case '0':
-	case '1':
-	case '2':
-	case '3':
-	case '4':
-	case '5':
-	case '6':
-	case '7':
-	case '8':
-	case '9': add_number_literal(); break;
-
-	default:
-		if (is_alpha(c)) {
-			add_identifier();
-		} else {
-			Lox::error(m_line, fmt_str("Unexpected character: %c", c));
-		}
-		break;
+	case CharClass::QUOTE: add_string_literal(); break;
+	case CharClass::DIGIT: add_number_literal(); break;
+	case CharClass::ALPHA: add_identifier(); break;
+
+	case CharClass::INVALID: error(m_start, fmt_str("Unexpected character: %c", c)); break;
 	}
+	ignore_warning_end();
 }
 
 char
@@ -133,8 +447,23 @@ Scanner::advance()
 void
 Scanner::add_token(const TokenType type)
 {
-	std::string lexeme = get_source().substr(m_start, m_current - m_start);
-	m_tokens.emplace_back(type, m_line, Value(), std::move(lexeme));
+	m_tokens.push_back(type, m_start, m_current - m_start);
+}
+
+void
+Scanner::error(const size_t offset, const std::string& message)
+{
+	if (m_defer_errors) {
+		m_deferred_errors.push_back({offset, message});
+	} else {
+		Lox::error(offset, message);
+	}
+}
+
+std::string_view
+Scanner::get_lexeme() const
+{
+	return get_source().substr(m_start, m_current - m_start);
 }
 
 // =====================================================================================================================
@@ -170,18 +499,28 @@ Scanner::match(const char expected)
 	return true;
 }
 
+void
+Scanner::skip_whitespace()
+{
+	// Most runs are a single space between two tokens; only hand longer runs to the bulk kernel.
+	const char next = peek();
+	if (next != ' ' && next != '\t' && next != '\r' && next != '\n') {
+		return;
+	}
+	m_current = scan_kernels::skip_whitespace(get_source(), m_current);
+}
+
 void
 Scanner::skip_slash_star_comment()
 {
 	size_t depth = 1;
 	while (depth > 0) {
+		// Jump to the next "/*" or "*/" delimiter.
+		m_current = scan_kernels::find_comment_delimiter(get_source(), m_current);
 		if (is_at_end()) {
-			Lox::error(m_line, fmt_str("Unterminated comment."));
+			error(m_current, "Unterminated comment.");
 			return;
 		}
-		if (peek() == '\n') {
-			m_line++;
-		}
 		if (peek() == '/' && peek_next() == '*') {
 			depth++;
 			advance();
@@ -196,22 +535,16 @@ Scanner::skip_slash_star_comment()
 void
 Scanner::add_string_literal()
 {
-	while (peek() != '"' && !is_at_end()) {
-		if (peek() == '\n') {
-			m_line++;
-		}
-		advance();
-	}
+	m_current = scan_kernels::find_string_end(get_source(), m_current);
 
 	if (is_at_end()) {
-		Lox::error(m_line, fmt_str("Unterminated string."));
+		error(m_current, "Unterminated string.");
 		return;
 	}
 
 	advance(); // Consume the closing quote.
 
-	std::string value = get_source().substr(m_start + 1, m_current - m_start - 2);
-	add_token(TokenType::STRING, Value(value));
+	add_token(TokenType::STRING, Value(std::string(get_source().substr(m_start + 1, m_current - m_start - 2))));
 }
 
 void
@@ -227,7 +560,24 @@ Scanner::add_number_literal()
 			advance();
 		}
 	}
-	const double value = std::stod(get_source().substr(m_start, m_current - m_start));
+	// Parse the digits in place: no temporary string, and unlike `std::stod` independent of the C locale.
+	const std::string_view lexeme = get_lexeme();
+	double value = 0.0;
+	const auto [end, status] = std::from_chars(lexeme.data(), lexeme.data() + lexeme.size(), value);
+	if (status == std::errc::result_out_of_range) {
+		// A literal has no sign or exponent, so it is too large exactly when its integer part is not all zeros.
+		// Otherwise it is too small even for a subnormal, and its nearest double is zero.
+		const std::string_view integer_part = lexeme.substr(0, lexeme.find('.'));
+		if (integer_part.find_first_not_of('0') != std::string_view::npos) {
+			// Keep the token so that the parser does not report a second, unrelated error.
+			error(m_start, "Number literal is out of range.");
+			value = std::numeric_limits<double>::infinity();
+		} else {
+			value = 0.0;
+		}
+	} else {
+		require_assert(status == std::errc() && end == lexeme.data() + lexeme.size());
+	}
 	add_token(TokenType::NUMBER, Value(value));
 }
 
@@ -237,13 +587,13 @@ Scanner::add_identifier()
 	while (is_alpha_numeric(peek())) {
 		advance();
 	}
-	const std::string text = get_source().substr(m_start, m_current - m_start);
-	const auto token_it = keyword_map().find(text);
-	TokenType type = TokenType::IDENTIFIER;
-	if (token_it != keyword_map().end()) {
-		type = token_it->second;
+	const std::string_view lexeme = get_lexeme();
+	const TokenType type = identifier_type(lexeme);
+	if (type == TokenType::IDENTIFIER) {
+		m_tokens.push_back(type, m_start, lexeme.size(), m_symbols->intern(lexeme));
+	} else {
+		add_token(type);
 	}
-	add_token(type);
 }
 
 // =====================================================================================================================
@@ -255,41 +605,9 @@ Scanner::is_digit(const char ch) // NOLINT(readability-identifier-length)
 	return ch >= '0' && ch <= '9';
 }
 
-bool
-Scanner::is_alpha(const char ch) // NOLINT(readability-identifier-length)
-{
-	return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '_';
-}
-
 bool
 Scanner::is_alpha_numeric(const char ch) // NOLINT(readability-identifier-length)
 {
-	return is_alpha(ch) || is_digit(ch);
-}
-
-// clang-format off
-IGNORE_WARNING_BEGIN("-Wexit-time-destructors")
-const std::unordered_map<std::string, TokenType>& Scanner::keyword_map()
-{
-	static const std::unordered_map<std::string, TokenType> keywords = {
-		{"and", TokenType::AND},
-		{"class", TokenType ::CLASS},
-		{"else", TokenType::ELSE},
-		{"false", TokenType::FALSE},
-		{"for", TokenType::FOR},
-		{"fun", TokenType::FUN},
-		{"if", TokenType::IF},
-		{"nil", TokenType::NIL},
-		{"or", TokenType::OR},
-		{"print", TokenType::PRINT},
-		{"return", TokenType::RETURN},
-		{"super", TokenType::SUPER},
-		{"this", TokenType::THIS},
-		{"true", TokenType::TRUE},
-		{"var", TokenType::VAR},
-		{"while", TokenType::WHILE},
-	};
-	return keywords;
-}
-IGNORE_WARNING_END()
-// clang-format on
+	const CharClass kind = char_class(ch);
+	return kind == CharClass::ALPHA || kind == CharClass::DIGIT;
+}
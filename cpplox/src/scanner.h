@@ -3,30 +3,90 @@
 
 #include <concepts>
 #include <cstddef>
+#include <memory_resource>
 #include <string>
-#include <unordered_map>
+#include <string_view>
 #include <vector>
 
+#include "general.h"
+#include "symbol_table.h"
 #include "token.h"
+#include "token_stream.h"
 #include "token_type.h"
 #include "value.h"
 
+enum class ScanMode
+{
+	SERIAL,
+	// Split large sources into chunks and scan them on worker threads. The result, including line numbers and the
+	// order of error reports, is identical to a serial scan.
+	PARALLEL,
+	// Scan one token per `next_token` call and keep none of them, so memory use does not grow with the source. Scan
+	// errors are held back until `finish`.
+	ON_DEMAND,
+};
+
+/*
+ *	@brief
+ *		Scans a borrowed, immutable source buffer into a `TokenStream`. Lexemes are views into `source`, which
+ *		therefore must outlive the scanner and every token it produces.
+ */
 class Scanner
 {
 public:
-	explicit Scanner(std::string source);
-	[[nodiscard]] const std::vector<Token>& get_tokens() const;
+	// The tokens are kept in memory from `resource`; chunks of a PARALLEL scan use the heap until they are merged.
+	explicit Scanner(std::string_view source, ScanMode mode = ScanMode::SERIAL,
+		std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+	// Every token of the source; in ON_DEMAND mode only the last one scanned.
+	[[nodiscard]] const TokenStream& get_tokens() const;
+
+	// The next token in source order, then END_OF_FILE over and over.
+	Token next_token();
+
+	// The literal of the NUMBER or STRING token `next_token` returned last. On demand it is moved out of the scanner.
+	[[nodiscard]] Value take_literal();
+
+	// Scans the rest of the source if tokens are scanned on demand, and reports the scan errors held back so far.
+	void finish();
+
+	// Into how many chunks a PARALLEL scan splits a source of this size; 1 means it is scanned serially.
+	[[nodiscard]] static size_t parallel_chunk_count(size_t source_size);
 
 private:
-	std::string m_source;
-	std::vector<Token> m_tokens;
+	// A scan error seen by a chunk scanner, reported once all chunks are merged.
+	struct DeferredError {
+		size_t offset;
+		std::string message;
+	};
+
+	// What a chunk scanner hands back to be merged; symbols are relative to the chunk's own symbol table.
+	struct ChunkResult {
+		TokenStream tokens;
+		SymbolTable symbols;
+		std::vector<DeferredError> errors;
+	};
+
+	std::string_view m_source;
+	TokenStream m_tokens;
+	SymbolTable* m_symbols;
+	std::vector<DeferredError> m_deferred_errors;
 
 	size_t m_start = 0;
 	size_t m_current = 0;
-	size_t m_line = 1;
+	size_t m_next_token = 0;
+	size_t m_last_token = 0;
+	bool m_defer_errors = false;
+	bool m_on_demand = false;
+	CLASS_PADDING(6);
+
+	// Chunk scanner: scans `source` from `begin` to its end into `symbols`, deferring error reports.
+	Scanner(std::string_view source, size_t begin, SymbolTable& symbols);
 
-	[[nodiscard]] std::string get_source() const;
+	[[nodiscard]] std::string_view get_source() const;
 	void scan_tokens();
+	void scan_parallel(size_t chunk_count);
+	void error(size_t offset, const std::string& message);
 	[[nodiscard]] bool is_at_end() const;
 	void scan_token();
 	char advance();
@@ -37,22 +97,24 @@ private:
 		requires std::convertible_to<T_Value, Value>
 	void add_token(TokenType type, T_Value&& literal)
 	{
-		std::string lexeme = get_source().substr(m_start, m_current - m_start);
-		m_tokens.emplace_back(type, m_line, std::forward<T_Value>(literal), std::move(lexeme));
+		m_tokens.push_back(type, m_start, m_current - m_start, std::forward<T_Value>(literal));
 	}
 
+	[[nodiscard]] std::string_view get_lexeme() const;
 	[[nodiscard]] char peek() const;
 	[[nodiscard]] char peek_next() const;
 	bool match(char expected);
+	void skip_whitespace();
 	void skip_slash_star_comment();
 	void add_string_literal();
 	void add_number_literal();
 	void add_identifier();
 
+	[[nodiscard]] static ChunkResult scan_chunk(std::string_view source, size_t begin, size_t end);
+	[[nodiscard]] static std::vector<size_t> find_chunk_boundaries(std::string_view source, size_t chunk_count);
+
 	static bool is_digit(char ch);		   // NOLINT(readability-identifier-length)
-	static bool is_alpha(char ch);		   // NOLINT(readability-identifier-length)
 	static bool is_alpha_numeric(char ch); // NOLINT(readability-identifier-length)
-	static const std::unordered_map<std::string, TokenType>& keyword_map();
 };
 
 #endif // SCANNER_H
@@ -0,0 +1,105 @@
+#include "symbol_table.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "general.h"
+
+// =====================================================================================================================
+// Public methods
+
+SymbolTable&
+SymbolTable::global()
+{
+	ignore_warning_begin("-Wexit-time-destructors");
+	static SymbolTable table;
+	ignore_warning_end();
+	return table;
+}
+
+SymbolId
+SymbolTable::intern(const std::string_view name)
+{
+	// Keep the load factor at or below one half.
+	if ((m_entries.size() + 1) * 2 > m_slots.size()) {
+		grow();
+	}
+
+	const size_t hash = std::hash<std::string_view>{}(name);
+	const size_t slot = find_slot(name, hash);
+	if (m_slots[slot] != 0) {
+		return static_cast<SymbolId>(m_slots[slot] - 1);
+	}
+
+	require_assert(m_entries.size() < static_cast<size_t>(SymbolId::NONE));
+	const auto symbol = static_cast<uint32_t>(m_entries.size());
+	m_entries.push_back({m_names.emplace_back(name), hash});
+	m_slots[slot] = symbol + 1;
+	return static_cast<SymbolId>(symbol);
+}
+
+std::vector<SymbolId>
+SymbolTable::merge(const SymbolTable& other)
+{
+	std::vector<SymbolId> mapping;
+	mapping.reserve(other.m_entries.size());
+	for (const Entry& entry : other.m_entries) {
+		mapping.push_back(intern(entry.name));
+	}
+	return mapping;
+}
+
+std::string_view
+SymbolTable::get_name(const SymbolId symbol) const
+{
+	require_assert(static_cast<size_t>(symbol) < m_entries.size());
+	return m_entries[static_cast<size_t>(symbol)].name;
+}
+
+size_t
+SymbolTable::size() const
+{
+	return m_entries.size();
+}
+
+// =====================================================================================================================
+// Private methods
+
+size_t
+SymbolTable::find_slot(const std::string_view name, const size_t hash) const
+{
+	// Linear probing; the stored hash rejects almost every mismatch before the names are compared.
+	const size_t mask = m_slots.size() - 1;
+	for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+		const uint32_t occupant = m_slots[slot];
+		if (occupant == 0) {
+			return slot;
+		}
+		const Entry& entry = m_entries[occupant - 1];
+		if (entry.hash == hash && entry.name == name) {
+			return slot;
+		}
+	}
+}
+
+void
+SymbolTable::grow()
+{
+	constexpr size_t initial_slots = 256;
+	const size_t slot_count = m_slots.empty() ? initial_slots : m_slots.size() * 2;
+	m_slots.assign(slot_count, 0);
+
+	// Reinsert from the stored hashes; names are unique, so the first empty slot is the right one.
+	const size_t mask = slot_count - 1;
+	for (size_t index = 0; index < m_entries.size(); ++index) {
+		size_t slot = m_entries[index].hash & mask;
+		while (m_slots[slot] != 0) {
+			slot = (slot + 1) & mask;
+		}
+		m_slots[slot] = static_cast<uint32_t>(index + 1);
+	}
+}
@@ -0,0 +1,60 @@
+#ifndef SYMBOL_TABLE_H
+#define SYMBOL_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+ *	@brief
+ *		Handle to an interned identifier. Two identifiers have the same symbol if and only if they are spelled the same,
+ *		so symbols can be compared and hashed as plain integers.
+ */
+enum class SymbolId : std::uint32_t
+{
+	NONE = UINT32_MAX,
+};
+
+/*
+ *	@brief
+ *		Interns identifier spellings into dense `SymbolId`s, storing each spelling once. Names live in storage that
+ *		never moves, and every entry keeps its hash, so growing the index never touches the names again.
+ *
+ *		The table is not thread-safe. Worker threads intern into tables of their own and the owner merges them with
+ *		`merge`.
+ */
+class SymbolTable
+{
+public:
+	// The table shared by the scanner, parser and interpreter.
+	static SymbolTable& global();
+
+	SymbolId intern(std::string_view name);
+
+	// Interns every name of `other` and returns the mapping from `other`'s symbols to this table's symbols.
+	[[nodiscard]] std::vector<SymbolId> merge(const SymbolTable& other);
+
+	[[nodiscard]] std::string_view get_name(SymbolId symbol) const;
+	[[nodiscard]] size_t size() const;
+
+private:
+	struct Entry {
+		std::string_view name;
+		size_t hash;
+	};
+
+	// Backing storage for the names; a deque never relocates its elements.
+	std::deque<std::string> m_names;
+	std::vector<Entry> m_entries;
+
+	// Open-addressing index into `m_entries`. Slots hold the symbol plus one, zero marks an empty slot.
+	std::vector<std::uint32_t> m_slots;
+
+	[[nodiscard]] size_t find_slot(std::string_view name, size_t hash) const;
+	void grow();
+};
+
+#endif // SYMBOL_TABLE_H
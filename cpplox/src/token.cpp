@@ -3,19 +3,20 @@
 
 #include <cstddef>
 #include <format>
+#include <string_view>
 
-Token::Token(TokenType type, std::string lexeme) : m_line(1), m_lexeme(std::move(lexeme)), m_type(type)
+Token::Token(TokenType type, std::string_view lexeme) : m_offset(0), m_lexeme(lexeme), m_type(type)
 {
 	// Empty constructor.
 }
 
-Token::Token(TokenType type, size_t line) : m_line(line), m_type(type)
+Token::Token(TokenType type, size_t offset) : m_offset(offset), m_type(type)
 {
 	// Empty constructor.
 }
 
-Token::Token(TokenType type, size_t line, Value literal, std::string lexeme)
-	: m_line(line), m_lexeme(std::move(lexeme)), m_literal(std::move(literal)), m_type(type)
+Token::Token(TokenType type, size_t offset, std::string_view lexeme, SymbolId symbol)
+	: m_offset(offset), m_lexeme(lexeme), m_symbol(symbol), m_type(type)
 {
 	// Empty constructor.
 }
@@ -23,33 +24,33 @@ Token::Token(TokenType type, size_t line, Value literal, std::string lexeme)
 std::string
 Token::to_string() const
 {
-	return std::format("Token{{type={}, line={}, lexeme={}, literal={}}}", m_type, m_line, m_lexeme, m_literal);
+	return std::format("Token{{type={}, offset={}, lexeme={}}}", m_type, m_offset, m_lexeme);
 }
 
 size_t
-Token::get_line() const
+Token::get_offset() const
 {
-	return m_line;
+	return m_offset;
 }
 
-std::string
+std::string_view
 Token::get_lexeme() const
 {
 	return m_lexeme;
 }
 
-Value
-Token::get_literal() const
-{
-	return m_literal;
-}
-
 TokenType
 Token::get_type() const
 {
 	return m_type;
 }
 
+SymbolId
+Token::get_symbol() const
+{
+	return m_symbol;
+}
+
 std::ostream&
 operator<<(std::ostream& output_s, const Token& token)
 {
@@ -5,33 +5,49 @@
 #include <format>
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <type_traits>
 
+#include "general.h"
+#include "symbol_table.h"
 #include "token_type.h"
-#include "value.h"
 
+/*
+ *	@brief
+ *		A lexical token. The lexeme is a view into the source buffer the token was scanned from, so the buffer must
+ *		outlive every token (and every AST node) that refers to it.
+ *
+ *		Tokens are trivially copyable, so the parser and the AST copy them freely. The literal value of a NUMBER or
+ *		STRING token is not part of it; the parser moves it from the scanner straight into the `Literal` node.
+ */
 class Token
 {
 public:
-	Token(TokenType type, std::string lexeme);
-	Token(TokenType type, size_t line);
-	Token(TokenType type, size_t line, Value literal, std::string lexeme);
+	Token(TokenType type, std::string_view lexeme);
+	Token(TokenType type, size_t offset);
+	Token(TokenType type, size_t offset, std::string_view lexeme, SymbolId symbol = SymbolId::NONE);
 	[[nodiscard]] std::string to_string() const;
 
 	friend std::ostream& operator<<(std::ostream& output_s, const Token& token);
 
-	[[nodiscard]] size_t get_line() const;
-	[[nodiscard]] std::string get_lexeme() const;
-	[[nodiscard]] Value get_literal() const;
+	// Byte offset of the lexeme in the source; `Lox` turns it into a line when reporting.
+	[[nodiscard]] size_t get_offset() const;
+	[[nodiscard]] std::string_view get_lexeme() const;
 	[[nodiscard]] TokenType get_type() const;
 
+	// The interned name of an IDENTIFIER token, `SymbolId::NONE` for every other token.
+	[[nodiscard]] SymbolId get_symbol() const;
+
 private:
-	size_t m_line;
-	std::string m_lexeme;
-	Value m_literal;
+	size_t m_offset;
+	std::string_view m_lexeme;
+	SymbolId m_symbol = SymbolId::NONE;
 	TokenType m_type;
-	CLASS_PADDING(4);
+	CLASS_PADDING(3);
 };
 
+static_assert(std::is_trivially_copyable_v<Token>);
+
 template <>
 struct std::formatter<Token> : std::formatter<std::string> { // NOLINT(altera-struct-pack-align)
 	auto format(const Token& token, format_context& ctx) const
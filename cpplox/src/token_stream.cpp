@@ -0,0 +1,170 @@
+#include "token_stream.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <memory_resource>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "general.h"
+#include "symbol_table.h"
+#include "token.h"
+#include "token_type.h"
+#include "value.h"
+
+namespace {
+
+uint32_t
+narrow(const size_t value)
+{
+	require_assert(value <= std::numeric_limits<uint32_t>::max());
+	return static_cast<uint32_t>(value);
+}
+
+} // namespace
+
+// =====================================================================================================================
+// Constructors
+
+TokenStream::TokenStream(const std::string_view source, std::pmr::memory_resource* const resource)
+	: m_source(source), m_types(resource), m_offsets(resource), m_lengths(resource), m_symbols(resource),
+	  m_literals(resource)
+{
+	// Offsets and lengths are stored in 32 bits.
+	require_throw(source.size() <= std::numeric_limits<uint32_t>::max(),
+		std::length_error("Source is too large: token offsets are limited to 4 GiB."));
+}
+
+// =====================================================================================================================
+// Public methods
+
+void
+TokenStream::push_back(const TokenType type, const size_t offset, const size_t length)
+{
+	m_types.push_back(type);
+	m_offsets.push_back(narrow(offset));
+	m_lengths.push_back(narrow(length));
+	m_symbols.push_back(SymbolId::NONE);
+}
+
+void
+TokenStream::push_back(const TokenType type, const size_t offset, const size_t length, Value literal)
+{
+	m_literals.emplace_back(narrow(m_types.size()), std::move(literal));
+	push_back(type, offset, length);
+}
+
+void
+TokenStream::push_back(const TokenType type, const size_t offset, const size_t length, const SymbolId symbol)
+{
+	push_back(type, offset, length);
+	m_symbols.back() = symbol;
+}
+
+void
+TokenStream::reserve(const size_t token_count, const size_t literal_count)
+{
+	m_types.reserve(token_count);
+	m_offsets.reserve(token_count);
+	m_lengths.reserve(token_count);
+	m_symbols.reserve(token_count);
+	m_literals.reserve(literal_count);
+}
+
+void
+TokenStream::clear()
+{
+	m_types.clear();
+	m_offsets.clear();
+	m_lengths.clear();
+	m_symbols.clear();
+	m_literals.clear();
+}
+
+void
+TokenStream::append(const TokenStream& other, const std::vector<SymbolId>& symbol_map)
+{
+	require_assert(other.m_source.data() == m_source.data());
+
+	const uint32_t index_offset = narrow(m_types.size());
+	m_types.insert(m_types.end(), other.m_types.begin(), other.m_types.end());
+	m_offsets.insert(m_offsets.end(), other.m_offsets.begin(), other.m_offsets.end());
+	m_lengths.insert(m_lengths.end(), other.m_lengths.begin(), other.m_lengths.end());
+	std::ranges::transform(other.m_symbols, std::back_inserter(m_symbols), [&symbol_map](const SymbolId symbol) {
+		return symbol == SymbolId::NONE ? symbol : symbol_map[static_cast<size_t>(symbol)];
+	});
+	for (const auto& [index, literal] : other.m_literals) {
+		m_literals.emplace_back(index + index_offset, literal);
+	}
+}
+
+size_t
+TokenStream::size() const
+{
+	return m_types.size();
+}
+
+size_t
+TokenStream::literal_count() const
+{
+	return m_literals.size();
+}
+
+TokenType
+TokenStream::get_type(const size_t index) const
+{
+	return m_types[index];
+}
+
+size_t
+TokenStream::get_offset(const size_t index) const
+{
+	return m_offsets[index];
+}
+
+std::string_view
+TokenStream::get_lexeme(const size_t index) const
+{
+	return m_source.substr(m_offsets[index], m_lengths[index]);
+}
+
+const Value&
+TokenStream::get_literal(const size_t index) const
+{
+	ignore_warning_begin("-Wexit-time-destructors");
+	static const Value nil;
+	ignore_warning_end();
+
+	const auto it = std::ranges::lower_bound(m_literals, index, {}, &std::pair<uint32_t, Value>::first);
+	if (it == m_literals.end() || it->first != index) {
+		return nil;
+	}
+	return it->second;
+}
+
+Value
+TokenStream::take_literal(const size_t index)
+{
+	const auto it = std::ranges::lower_bound(m_literals, index, {}, &std::pair<uint32_t, Value>::first);
+	if (it == m_literals.end() || it->first != index) {
+		return Value();
+	}
+	return std::exchange(it->second, Value());
+}
+
+SymbolId
+TokenStream::get_symbol(const size_t index) const
+{
+	return m_symbols[index];
+}
+
+Token
+TokenStream::get_token(const size_t index) const
+{
+	return {get_type(index), get_offset(index), get_lexeme(index), get_symbol(index)};
+}
@@ -0,0 +1,67 @@
+#ifndef TOKEN_STREAM_H
+#define TOKEN_STREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "symbol_table.h"
+#include "token.h"
+#include "token_type.h"
+#include "value.h"
+
+/*
+ *	@brief
+ *		The scanner's output as parallel arrays: token type, source offset/length and symbol, plus a side table holding
+ *		the literal values of the few NUMBER and STRING tokens. A punctuation token costs 13 bytes and no heap
+ *		allocation; lines are only computed from the offsets when an error is reported. Lexemes are views into the
+ *		source buffer, which must outlive the stream.
+ */
+class TokenStream
+{
+public:
+	// The arrays are allocated from `resource`.
+	explicit TokenStream(
+		std::string_view source, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+	void push_back(TokenType type, size_t offset, size_t length);
+	void push_back(TokenType type, size_t offset, size_t length, Value literal);
+	void push_back(TokenType type, size_t offset, size_t length, SymbolId symbol);
+
+	void reserve(size_t token_count, size_t literal_count);
+
+	// Removes all tokens but keeps the allocated capacity.
+	void clear();
+
+	// Appends the tokens of `other`, which must view the same source, translating their symbols through `symbol_map`.
+	void append(const TokenStream& other, const std::vector<SymbolId>& symbol_map);
+
+	[[nodiscard]] size_t size() const;
+	[[nodiscard]] size_t literal_count() const;
+	[[nodiscard]] TokenType get_type(size_t index) const;
+	[[nodiscard]] size_t get_offset(size_t index) const;
+	[[nodiscard]] std::string_view get_lexeme(size_t index) const;
+	[[nodiscard]] const Value& get_literal(size_t index) const;
+
+	// Moves the literal of the token at `index` out of the stream, leaving nil behind.
+	[[nodiscard]] Value take_literal(size_t index);
+	[[nodiscard]] SymbolId get_symbol(size_t index) const;
+
+	// Materializes the token at `index`. Prefer the per-field accessors on hot paths.
+	[[nodiscard]] Token get_token(size_t index) const;
+
+private:
+	std::string_view m_source;
+	std::pmr::vector<TokenType> m_types;
+	std::pmr::vector<uint32_t> m_offsets;
+	std::pmr::vector<uint32_t> m_lengths;
+	std::pmr::vector<SymbolId> m_symbols;
+
+	// (token index, literal) pairs, sorted by token index since tokens are only ever appended.
+	std::pmr::vector<std::pair<uint32_t, Value>> m_literals;
+};
+
+#endif // TOKEN_STREAM_H
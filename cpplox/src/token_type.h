@@ -1,12 +1,16 @@
 #ifndef TOKEN_TYPE_H
 #define TOKEN_TYPE_H
 
+#include <cstddef>
+#include <cstdint>
 #include <format>
 #include <iostream>
+#include <string_view>
+#include <type_traits>
 
 #include "general.h"
 
-enum class TokenType
+enum class TokenType : std::uint8_t
 {
 	// Single-character tokens.
 	LEFT_PAREN,	 // (
@@ -60,6 +64,179 @@ enum class TokenType
 	END_OF_FILE, // EOF
 };
 
+// Number of enumerators in `TokenType`.
+constexpr size_t token_type_count = static_cast<size_t>(TokenType::END_OF_FILE) + 1;
+
+// =====================================================================================================================
+// Token sets.
+
+/*
+ *	@brief
+ *		A set of token types as a bit mask, one bit per enumerator. Sets are built at compile time, so testing whether
+ *		a token belongs to one of the parser's operator sets is a single AND.
+ */
+class TokenSet
+{
+public:
+	template <typename... VT_TokenType>
+		requires((std::is_same_v<VT_TokenType, TokenType>) && ...)
+	constexpr explicit TokenSet(const VT_TokenType... types) : m_bits((bit(types) | ... | std::uint64_t{0}))
+	{
+		// Empty constructor.
+	}
+
+	[[nodiscard]] constexpr bool contains(const TokenType type) const
+	{
+		return (m_bits & bit(type)) != 0;
+	}
+
+private:
+	static_assert(token_type_count <= 64, "TokenSet holds one bit per token type in a 64-bit mask.");
+
+	std::uint64_t m_bits;
+
+	static constexpr std::uint64_t bit(const TokenType type)
+	{
+		return std::uint64_t{1} << static_cast<std::uint8_t>(type);
+	}
+};
+
+// =====================================================================================================================
+// Punctuator spellings.
+
+/*
+ *	@brief
+ *		The fixed spelling of a punctuator (single- and two-character tokens), or an empty view for every other token
+ *		type. The scanner derives its character-class and operator tables from this list at compile time, so a new
+ *		operator only needs an enumerator and a spelling here.
+ */
+constexpr std::string_view
+punctuator_spelling(const TokenType type)
+{
+	// clang-format off
+	ignore_warning_begin("-Wswitch-default");
+	// clang-format on
+	switch (type) {
+	case TokenType::LEFT_PAREN: return "(";
+	case TokenType::RIGHT_PAREN: return ")";
+	case TokenType::LEFT_BRACE: return "{";
+	case TokenType::RIGHT_BRACE: return "}";
+	case TokenType::COMMA: return ",";
+	case TokenType::DOT: return ".";
+	case TokenType::MINUS: return "-";
+	case TokenType::PLUS: return "+";
+	case TokenType::COLON: return ":";
+	case TokenType::SEMICOLON: return ";";
+	case TokenType::QUESTION: return "?";
+	case TokenType::SLASH: return "/";
+	case TokenType::STAR: return "*";
+	case TokenType::BANG: return "!";
+	case TokenType::BANG_EQUAL: return "!=";
+	case TokenType::EQUAL: return "=";
+	case TokenType::EQUAL_EQUAL: return "==";
+	case TokenType::GREATER: return ">";
+	case TokenType::GREATER_EQUAL: return ">=";
+	case TokenType::LESS: return "<";
+	case TokenType::LESS_EQUAL: return "<=";
+	case TokenType::IDENTIFIER:
+	case TokenType::STRING:
+	case TokenType::NUMBER:
+	case TokenType::AND:
+	case TokenType::CLASS:
+	case TokenType::ELSE:
+	case TokenType::FALSE:
+	case TokenType::FUN:
+	case TokenType::FOR:
+	case TokenType::IF:
+	case TokenType::NIL:
+	case TokenType::OR:
+	case TokenType::PRINT:
+	case TokenType::RETURN:
+	case TokenType::SUPER:
+	case TokenType::THIS:
+	case TokenType::TRUE:
+	case TokenType::VAR:
+	case TokenType::WHILE:
+	case TokenType::END_OF_FILE: return {};
+	}
+	ignore_warning_end();
+	return {};
+}
+
+// =====================================================================================================================
+// Keyword recognition.
+
+namespace token_type_detail {
+
+constexpr TokenType
+keyword_if(const std::string_view text, const std::string_view keyword, const TokenType type)
+{
+	return text == keyword ? type : TokenType::IDENTIFIER;
+}
+
+} // namespace token_type_detail
+
+/*
+ *	@brief
+ *		Classifies a scanned identifier as one of the 16 keywords or as a plain IDENTIFIER. Dispatches on the length and
+ *		first character, so every input is settled by at most one string comparison and nothing is allocated.
+ *
+ *	@param text
+ *		The identifier lexeme.
+ *
+ *	@return
+ *		The keyword's token type, or `TokenType::IDENTIFIER`.
+ */
+constexpr TokenType
+identifier_type(const std::string_view text)
+{
+	using token_type_detail::keyword_if;
+
+	// clang-format off
+	ignore_warning_begin("-Wswitch-default");
+	// clang-format on
+	switch (text.size()) {
+	case 2:
+		switch (text[0]) {
+		case 'i': return keyword_if(text, "if", TokenType::IF);
+		case 'o': return keyword_if(text, "or", TokenType::OR);
+		}
+		break;
+	case 3:
+		switch (text[0]) {
+		case 'a': return keyword_if(text, "and", TokenType::AND);
+		case 'f':
+			return text[1] == 'o' ? keyword_if(text, "for", TokenType::FOR)
+				: keyword_if(text, "fun", TokenType::FUN);
+		case 'n': return keyword_if(text, "nil", TokenType::NIL);
+		case 'v': return keyword_if(text, "var", TokenType::VAR);
+		}
+		break;
+	case 4:
+		switch (text[0]) {
+		case 'e': return keyword_if(text, "else", TokenType::ELSE);
+		case 't':
+			return text[1] == 'h' ? keyword_if(text, "this", TokenType::THIS)
+				: keyword_if(text, "true", TokenType::TRUE);
+		}
+		break;
+	case 5:
+		switch (text[0]) {
+		case 'c': return keyword_if(text, "class", TokenType::CLASS);
+		case 'f': return keyword_if(text, "false", TokenType::FALSE);
+		case 'p': return keyword_if(text, "print", TokenType::PRINT);
+		case 's': return keyword_if(text, "super", TokenType::SUPER);
+		case 'w': return keyword_if(text, "while", TokenType::WHILE);
+		}
+		break;
+	case 6: return keyword_if(text, "return", TokenType::RETURN);
+	}
+	ignore_warning_end();
+	return TokenType::IDENTIFIER;
+}
+
+// =====================================================================================================================
+
 inline std::string
 to_string(const TokenType type)
 {
@@ -36,6 +36,15 @@ tolower(const std::string& str)
 	return lower_str;
 }
 
+static std::string
+toupper(const std::string& str)
+{
+	std::string upper_str(str);
+	std::transform(upper_str.begin(), upper_str.end(), upper_str.begin(),
+		[](unsigned char c) { return std::toupper(c); });
+	return upper_str;
+}
+
 static std::string
 extract_type(const std::string& ptr_type)
 {
@@ -77,6 +86,26 @@ is_primitive_type(const std::string& type)
 	return is_bool_type(type);
 }
 
+// Tokens are trivially copyable; they are passed by reference and copied into the node.
+static bool
+is_token_type(const std::string& type)
+{
+	return type == "Token";
+}
+
+static std::string
+parameter_type(const std::string& type)
+{
+	return is_token_type(type) ? "const " + type + "&" : type;
+}
+
+// A member holding child nodes of the same tree, as a pointer or a vector of them, which the destructor releases.
+static bool
+is_child_type(const std::string& type, const std::string& base_class_name)
+{
+	return extract_type(extract_type(type)) == "const " + base_class_name;
+}
+
 // NOLINTBEGIN(readability-function-cognitive-complexity, bugprone-easily-swappable-parameters)
 static int
 generate_ast(const std::string& output_dir_path, const std::vector<std::string>& additional_headers,
@@ -90,6 +119,8 @@ generate_ast(const std::string& output_dir_path, const std::vector<std::string>&
 	const char* const bcls_n = base_class_name.c_str();
 	const std::string base_variable_name = tolower(base_class_name);
 	const char* const bvar_n = base_variable_name.c_str();
+	const std::string kind_name = base_class_name + "Kind";
+	const char* const kind_n = kind_name.c_str();
 
 	// Generate header file.
 	const std::string header_file_name = tolower(base_class_name) + ".h";
@@ -115,12 +146,14 @@ generate_ast(const std::string& output_dir_path, const std::vector<std::string>&
 
 	// Includes
 	std::vector<std::string> system_includes = {
-		"<any>",
+		"<cstdint>",
 		"<memory>",
 		"<ostream>",
 		"<string>",
 	};
-	std::vector<std::string> user_includes;
+	std::vector<std::string> user_includes = {
+		"\"general.h\"",
+	};
 	for (const auto& header : additional_headers) {
 		if (header.find('<') != std::string::npos) {
 			system_includes.push_back(header);
@@ -151,8 +184,23 @@ generate_ast(const std::string& output_dir_path, const std::vector<std::string>&
 	hs << fmt_str("// =====================================================================================================================\n");
 	// clang-format on
 
+	// Kind enum
+	hs << fmt_str("// Concrete class of each %s node, to tell them apart with an integer compare instead of RTTI.\n",
+		bcls_n);
+	hs << fmt_str("enum class %s : std::uint8_t\n", kind_n);
+	hs << fmt_str("{\n");
+	for (const auto& ast_class : ast_classes) {
+		hs << fmt_str("	%s,\n", toupper(ast_class.get_class_name()).c_str());
+	}
+	hs << fmt_str("};\n\n");
+
+	// clang-format off
+	hs << fmt_str("// =====================================================================================================================\n");
+	// clang-format on
+
 	// Visitor class
-	hs << fmt_str("// Visitor class\n");
+	hs << fmt_str("// Visitor class, returning `R` from every visit.\n");
+	hs << fmt_str("template <typename R>\n");
 	hs << fmt_str("class %sVisitor\n", bcls_n);
 	hs << fmt_str("{\n");
 	hs << fmt_str("public:\n");
@@ -161,12 +209,12 @@ generate_ast(const std::string& output_dir_path, const std::vector<std::string>&
 	hs << fmt_str("	%sVisitor& operator=(const %sVisitor&) = default;\n", bcls_n, bcls_n);
 	hs << fmt_str("	%sVisitor(%sVisitor&&) noexcept = default;\n", bcls_n, bcls_n);
 	hs << fmt_str("	%sVisitor& operator=(%sVisitor&&) noexcept = default;\n", bcls_n, bcls_n);
-	hs << fmt_str("	virtual ~%sVisitor();\n\n", bcls_n);
+	hs << fmt_str("	virtual ~%sVisitor() = default;\n\n", bcls_n);
 
 	// Visitor methods
 	for (const auto& ast_class : ast_classes) {
-		hs << fmt_str("	[[nodiscard]] virtual std::any visit_%s_%s(const %s& %s) = 0;\n",
-			tolower(ast_class.get_class_name()).c_str(), bvar_n, ast_class.get_class_name().c_str(), bvar_n);
+		hs << fmt_str("	virtual R visit_%s_%s(const %s& %s) = 0;\n", tolower(ast_class.get_class_name()).c_str(),
+			bvar_n, ast_class.get_class_name().c_str(), bvar_n);
 	}
 	hs << fmt_str("};\n\n");
 	// clang-format off
@@ -178,22 +226,45 @@ generate_ast(const std::string& output_dir_path, const std::vector<std::string>&
 	hs << fmt_str("class %s\n", bcls_n);
 	hs << fmt_str("{\n");
 	hs << fmt_str("public:\n");
-	hs << fmt_str("	%s() = default;\n", bcls_n);
+	hs << fmt_str("	explicit %s(%s kind);\n", bcls_n, kind_n);
 	hs << fmt_str("	%s(const %s&) = default;\n", bcls_n, bcls_n);
 	hs << fmt_str("	%s& operator=(const %s&) = default;\n", bcls_n, bcls_n);
 	hs << fmt_str("	%s(%s&&) noexcept = default;\n", bcls_n, bcls_n);
 	hs << fmt_str("	%s& operator=(%s&&) noexcept = default;\n", bcls_n, bcls_n);
 	hs << fmt_str("	virtual ~%s();\n", bcls_n);
 	hs << fmt_str("\n");
-	hs << fmt_str("	[[nodiscard]] virtual std::any accept(%sVisitor& visitor) const = 0;\n", bcls_n);
+	hs << fmt_str("	// Calls the visit method for this node's class, picked by its kind instead of a virtual call.\n");
+	hs << fmt_str("	template <typename R>\n");
+	hs << fmt_str("	R accept(%sVisitor<R>& visitor) const;\n", bcls_n);
 	hs << fmt_str("	[[nodiscard]] virtual std::string to_string() const = 0;\n");
 	hs << fmt_str("	friend std::ostream& operator<<(std::ostream& out_s, const %s& %s);\n", bcls_n, bvar_n);
+	hs << fmt_str("\n");
+	hs << fmt_str("	// Defined inline so that checking the kind costs no call.\n");
+	hs << fmt_str("	[[nodiscard]] %s\n", kind_n);
+	hs << fmt_str("	kind() const\n");
+	hs << fmt_str("	{\n");
+	hs << fmt_str("		return m_kind;\n");
+	hs << fmt_str("	}\n");
+	hs << fmt_str("\n");
+	hs << fmt_str("protected:\n");
+	// clang-format off
+	hs << fmt_str("	// Destroys `child`, and the nodes only it refers to, without recursing: the destructor of a node with children\n");
+	hs << fmt_str("	// releases them, and they join the nodes that the outermost `release` running is yet to destroy. Tearing\n");
+	hs << fmt_str("	// down a tree of any depth thus costs no native stack.\n");
+	// clang-format on
+	hs << fmt_str("	static void release(std::shared_ptr<const %s>& child);\n", bcls_n);
+	hs << fmt_str("\n");
+	hs << fmt_str("private:\n");
+	hs << fmt_str("	%s m_kind;\n", kind_n);
+	hs << fmt_str("	CLASS_PADDING(7);\n");
 	hs << fmt_str("};\n\n");
 
 	// Derived classes
 	for (const auto& ast_class : ast_classes) {
 		const std::string& class_name = ast_class.get_class_name();
 		const std::vector<std::pair<std::string, std::string>>& members = ast_class.get_members();
+		const bool has_children = std::any_of(members.begin(), members.end(),
+			[&](const auto& member) { return is_child_type(member.first, base_class_name); });
 
 		// clang-format off
 		hs << fmt_str("// =====================================================================================================================\n");
@@ -208,12 +279,20 @@ generate_ast(const std::string& output_dir_path, const std::vector<std::string>&
 			hs << fmt_str("	%s(", class_name.c_str());
 		}
 		for (size_t i = 0; i < members.size(); ++i) {
-			hs << fmt_str("%s %s", members[i].first.c_str(), members[i].second.c_str());
+			hs << fmt_str("%s %s", parameter_type(members[i].first).c_str(), members[i].second.c_str());
 			if (i != members.size() - 1) {
 				hs << ", ";
 			}
 		}
 		hs << ");\n";
+		if (has_children) {
+			const char* const cls_n = class_name.c_str();
+			hs << fmt_str("	%s(const %s&) = default;\n", cls_n, cls_n);
+			hs << fmt_str("	%s& operator=(const %s&) = default;\n", cls_n, cls_n);
+			hs << fmt_str("	%s(%s&&) noexcept = default;\n", cls_n, cls_n);
+			hs << fmt_str("	%s& operator=(%s&&) noexcept = default;\n", cls_n, cls_n);
+			hs << fmt_str("	~%s() override;\n", cls_n);
+		}
 		hs << fmt_str("\n");
 
 		// Generate getters first
@@ -228,8 +307,7 @@ generate_ast(const std::string& output_dir_path, const std::vector<std::string>&
 		}
 		hs << fmt_str("\n");
 
-		// Then generate accept and to_string methods
-		hs << fmt_str("	[[nodiscard]] std::any accept(%sVisitor& visitor) const override;\n", bcls_n);
+		// Then generate the to_string method
 		hs << fmt_str("	[[nodiscard]] std::string to_string() const override;");
 		hs << "\n";
 		hs << fmt_str("private:\n");
@@ -240,6 +318,25 @@ generate_ast(const std::string& output_dir_path, const std::vector<std::string>&
 		hs << "\n";
 	}
 
+	// The accept template, once every class it casts to is complete.
+	// clang-format off
+	hs << fmt_str("// =====================================================================================================================\n");
+	// clang-format on
+	hs << fmt_str("template <typename R>\n");
+	hs << fmt_str("R\n");
+	hs << fmt_str("%s::accept(%sVisitor<R>& visitor) const\n", bcls_n, bcls_n);
+	hs << fmt_str("{\n");
+	hs << fmt_str("	ignore_warning_begin(\"-Wswitch-default\");\n");
+	hs << fmt_str("	switch (m_kind) {\n");
+	for (const auto& ast_class : ast_classes) {
+		const std::string& class_name = ast_class.get_class_name();
+		hs << fmt_str("	case %s::%s: return visitor.visit_%s_%s(static_cast<const %s&>(*this));\n", kind_n,
+			toupper(class_name).c_str(), tolower(class_name).c_str(), bvar_n, class_name.c_str());
+	}
+	hs << fmt_str("	}\n");
+	hs << fmt_str("	ignore_warning_end();\n");
+	hs << fmt_str("}\n\n");
+
 	hs << fmt_str("#endif // %s_H\n", tolower(base_class_name).c_str());
 	hs.close();
 
@@ -259,12 +356,7 @@ generate_ast(const std::string& output_dir_path, const std::vector<std::string>&
 
 	// Includes
 	cs << fmt_str("#include \"%s\"\n\n", header_file_name.c_str());
-
-	// clang-format off
-	cs << fmt_str("// =====================================================================================================================\n");
-	// clang-format on
-	cs << fmt_str("// visitor\n");
-	cs << fmt_str("%sVisitor::~%sVisitor() = default;\n\n", bcls_n, bcls_n);
+	cs << fmt_str("#include <vector>\n\n");
 
 	// clang-format off
 	cs << fmt_str("// =====================================================================================================================\n");
@@ -272,8 +364,35 @@ generate_ast(const std::string& output_dir_path, const std::vector<std::string>&
 
 	// Base class implementation
 	cs << fmt_str("// %s\n\n", bcls_n);
+	cs << fmt_str("%s::%s(const %s kind)\n", bcls_n, bcls_n, kind_n);
+	cs << fmt_str("	: m_kind(kind)\n");
+	cs << "{\n";
+	cs << fmt_str("	// Empty constructor.\n");
+	cs << "}\n\n";
 	cs << fmt_str("%s::~%s() = default;\n\n", bcls_n, bcls_n);
 
+	cs << fmt_str("void\n");
+	cs << fmt_str("%s::release(std::shared_ptr<const %s>& child)\n", bcls_n, bcls_n);
+	cs << fmt_str("{\n");
+	cs << fmt_str("	// Reused, so that once it has grown, releasing a tree allocates nothing.\n");
+	cs << fmt_str("	// NOLINTNEXTLINE(cppcoreguidelines-owning-memory)\n");
+	cs << fmt_str("	thread_local auto* pending = new std::vector<std::shared_ptr<const %s>>();\n", bcls_n);
+	cs << fmt_str("	thread_local bool is_releasing = false;\n");
+	cs << fmt_str("	require_nonnull_return(child);\n");
+	cs << fmt_str("	pending->push_back(std::move(child));\n");
+	cs << fmt_str("	require_return(!is_releasing);\n");
+	cs << fmt_str("	is_releasing = true;\n");
+	cs << fmt_str("	while (!pending->empty()) {\n");
+	// clang-format off
+	cs << fmt_str("		// If this is the last reference to the node, its destructor pushes the node's children in turn.\n");
+	// clang-format on
+	cs << fmt_str("		std::shared_ptr<const %s> node = std::move(pending->back());\n", bcls_n);
+	cs << fmt_str("		pending->pop_back();\n");
+	cs << fmt_str("		node.reset();\n");
+	cs << fmt_str("	}\n");
+	cs << fmt_str("	is_releasing = false;\n");
+	cs << fmt_str("}\n\n");
+
 	cs << fmt_str("std::ostream&\n");
 	cs << fmt_str("operator<<(std::ostream& out_s, const %s& %s)\n", bcls_n, bvar_n);
 	cs << fmt_str("{\n");
@@ -319,6 +438,8 @@ generate_ast(const std::string& output_dir_path, const std::vector<std::string>&
 	for (const auto& ast_class : ast_classes) {
 		const std::string& class_name = ast_class.get_class_name();
 		const std::vector<std::pair<std::string, std::string>>& members = ast_class.get_members();
+		const bool has_children = std::any_of(members.begin(), members.end(),
+			[&](const auto& member) { return is_child_type(member.first, base_class_name); });
 
 		// clang-format off
 		cs << "// =====================================================================================================================\n";
@@ -328,21 +449,18 @@ generate_ast(const std::string& output_dir_path, const std::vector<std::string>&
 		// Constructor
 		cs << fmt_str("%s::%s(", class_name.c_str(), class_name.c_str());
 		for (size_t i = 0; i < members.size(); ++i) {
-			cs << fmt_str("%s %s", members[i].first.c_str(), members[i].second.c_str());
+			cs << fmt_str("%s %s", parameter_type(members[i].first).c_str(), members[i].second.c_str());
 			if (i != members.size() - 1) {
 				cs << ", ";
 			}
 		}
 		cs << ")\n";
-		cs << fmt_str("	: ");
+		cs << fmt_str("	: %s(%s::%s)", bcls_n, kind_n, toupper(class_name).c_str());
 		for (size_t i = 0; i < members.size(); ++i) {
-			if (is_primitive_type(members[i].first)) {
-				cs << fmt_str("m_%s(%s)", members[i].second.c_str(), members[i].second.c_str());
+			if (is_primitive_type(members[i].first) || is_token_type(members[i].first)) {
+				cs << fmt_str(", m_%s(%s)", members[i].second.c_str(), members[i].second.c_str());
 			} else {
-				cs << fmt_str("m_%s(std::move(%s))", members[i].second.c_str(), members[i].second.c_str());
-			}
-			if (i != members.size() - 1) {
-				cs << ", ";
+				cs << fmt_str(", m_%s(std::move(%s))", members[i].second.c_str(), members[i].second.c_str());
 			}
 		}
 		cs << "\n";
@@ -350,6 +468,26 @@ generate_ast(const std::string& output_dir_path, const std::vector<std::string>&
 		cs << fmt_str("	// Empty constructor.\n");
 		cs << "}\n\n";
 
+		// Destructor, handing the children to `release` instead of destroying them recursively.
+		if (has_children) {
+			cs << fmt_str("%s::~%s()\n", class_name.c_str(), class_name.c_str());
+			cs << "{\n";
+			for (const auto& member : members) {
+				if (!is_child_type(member.first, base_class_name)) {
+					continue;
+				}
+				if (is_vector_type(member.first)) {
+					cs << fmt_str("	for (%s& node : m_%s) {\n", extract_type(member.first).c_str(),
+						member.second.c_str());
+					cs << fmt_str("		release(node);\n");
+					cs << fmt_str("	}\n");
+				} else {
+					cs << fmt_str("	release(m_%s);\n", member.second.c_str());
+				}
+			}
+			cs << "}\n\n";
+		}
+
 		// Getters (moved up, after constructor)
 		for (const auto& member : members) {
 			if (is_shared_ptr_type(member.first)) {
@@ -367,13 +505,6 @@ generate_ast(const std::string& output_dir_path, const std::vector<std::string>&
 			cs << "}\n\n";
 		}
 
-		// Accept method (after getters)
-		cs << fmt_str("std::any\n");
-		cs << fmt_str("%s::accept(%sVisitor& visitor) const\n", class_name.c_str(), bcls_n);
-		cs << "{\n";
-		cs << fmt_str("	return visitor.visit_%s_%s(*this);\n", tolower(class_name).c_str(), bvar_n);
-		cs << "}\n\n";
-
 		// to_string method (moved to end)
 		cs << fmt_str("std::string\n");
 		cs << fmt_str("%s::to_string() const\n", class_name.c_str());
@@ -414,8 +545,8 @@ generate_ast(const std::string& output_dir_path, const std::vector<std::string>&
 int
 main()
 {
-	generate_ast("src/asts", {"\"token.h\"", "\"value.h\""}, "Expr",
-		// clang-format off
+	// clang-format off
+	const std::vector<ASTClass> expr_classes =
 		{
 			ASTClass("Assign",
 				{
@@ -460,14 +591,9 @@ main()
 					{"Token",						"name"}
 				}
 			),
-		} // clang-format on
-	);
-
-	std::cout << std::format("======================") << std::endl;
+		};
 
-	// clang-format off
-	generate_ast("src/asts", {"<vector>", "\"expr.h\"", "\"token.h\""},
-		"Stmt",
+	const std::vector<ASTClass> stmt_classes =
 		{
 			ASTClass("Block",
 				{
@@ -495,9 +621,14 @@ main()
 					{"std::shared_ptr<const Expr>",	"initializer"}
 				}
 			),
-		}
-	);
+		};
 	// clang-format on
 
+	generate_ast("src/asts", {"\"token.h\"", "\"value.h\""}, "Expr", expr_classes);
+
+	std::cout << std::format("======================") << std::endl;
+
+	generate_ast("src/asts", {"<vector>", "\"expr.h\"", "\"token.h\""}, "Stmt", stmt_classes);
+
 	return 0;
 }
@@ -0,0 +1,865 @@
+/*
+ *	Microbenchmarks for the cpplox front end and runtime.
+ *
+ *	Usage: lox_benchmark [benchmark-name]
+ *
+ *	Without an argument every benchmark is run. Build with CMAKE_BUILD_TYPE=Release for meaningful numbers.
+ */
+
+#include <algorithm>
+#include <any>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <format>
+#include <iostream>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "asts/stmt.h"
+#include "environment.h"
+#include "general.h"
+#include "incremental_front_end.h"
+#include "lox.h"
+#include "parser.h"
+#include "scanner.h"
+#include "symbol_table.h"
+#include "token.h"
+#include "token_type.h"
+#include "utilities/arena.h"
+#include "value.h"
+#include "visitors/interpreter.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Written by every benchmark so that the measured work cannot be optimized away.
+volatile size_t g_sink = 0; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+// Number of calls to the global `operator new`, and the bytes they requested, counted by the replacements below.
+std::atomic<size_t> g_allocations = 0;	   // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+std::atomic<size_t> g_allocated_bytes = 0; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+// Set by a benchmark whose result contradicts what it checks, so that the run exits with an error.
+bool g_check_failed = false; // NOLINT(cppcoreguidelines-avoid-non-const-global-variables)
+
+/*
+ *	@brief
+ *		Runs `body` once and returns the elapsed wall-clock time in nanoseconds.
+ */
+template <typename T_Body>
+double
+measure_ns(T_Body&& body)
+{
+	const auto start = Clock::now();
+	std::forward<T_Body>(body)();
+	const auto end = Clock::now();
+	return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+}
+
+void
+report(const std::string_view name, const double total_ns, const size_t operations, const std::string_view unit)
+{
+	std::cout << std::format("  {:<40} {:>10.2f} ns/{}\n", name, total_ns / static_cast<double>(operations), unit);
+}
+
+// =====================================================================================================================
+// keywords: identifier-to-keyword classification.
+
+void
+benchmark_keywords()
+{
+	constexpr std::array<std::string_view, 40> words = {
+		"and", "class", "else", "false", "for", "fun", "if", "nil", "or", "print", "return", "super", "this", "true",
+		"var", "while", "x", "i", "count", "index", "total", "value", "forward", "printer", "variable", "result", "n",
+		"accumulator", "left", "right", "node", "fn", "thus", "whilst", "superb", "ifx", "tr", "str", "len", "orbit",
+	};
+	constexpr size_t rounds = 500'000;
+	const size_t operations = rounds * words.size();
+
+	// The previous implementation: build a std::string and look it up in a hash map.
+	const std::unordered_map<std::string, TokenType> keyword_map = {
+		{"and", TokenType::AND},
+		{"class", TokenType::CLASS},
+		{"else", TokenType::ELSE},
+		{"false", TokenType::FALSE},
+		{"for", TokenType::FOR},
+		{"fun", TokenType::FUN},
+		{"if", TokenType::IF},
+		{"nil", TokenType::NIL},
+		{"or", TokenType::OR},
+		{"print", TokenType::PRINT},
+		{"return", TokenType::RETURN},
+		{"super", TokenType::SUPER},
+		{"this", TokenType::THIS},
+		{"true", TokenType::TRUE},
+		{"var", TokenType::VAR},
+		{"while", TokenType::WHILE},
+	};
+
+	std::cout << std::format("keywords ({} lookups)\n", operations);
+
+	const double map_ns = measure_ns([&] {
+		size_t sum = 0;
+		for (size_t round = 0; round < rounds; ++round) {
+			for (const std::string_view word : words) {
+				const auto it = keyword_map.find(std::string(word));
+				sum += static_cast<size_t>(it == keyword_map.end() ? TokenType::IDENTIFIER : it->second);
+			}
+		}
+		g_sink = sum;
+	});
+	report("std::unordered_map<std::string>", map_ns, operations, "lookup");
+
+	const double switch_ns = measure_ns([&] {
+		size_t sum = 0;
+		for (size_t round = 0; round < rounds; ++round) {
+			for (const std::string_view word : words) {
+				sum += static_cast<size_t>(identifier_type(word));
+			}
+		}
+		g_sink = sum;
+	});
+	report("identifier_type (length/first-char switch)", switch_ns, operations, "lookup");
+}
+
+// =====================================================================================================================
+// scanner: lexing throughput on machine-generated sources.
+
+/*
+ *	@brief
+ *		Builds a source of roughly `target_size` bytes shaped like our generated configuration scripts: comment
+ *		banners, long string literals and short statements.
+ */
+std::string
+make_generated_script(const size_t target_size)
+{
+	const std::string stars(1000, '*');
+	const std::string banner = "/*" + stars + "\n *  generated section\n " + stars + "*/\n";
+	const std::string line_comment = "// " + std::string(120, '-') + "\n";
+	const std::string literal = "var text = \"" + std::string(2000, 'x') + "\";\n";
+	const std::string code = "var total = (alpha + 12.5) * beta - gamma / 3;\nprint total >= 100 ? \"big\" : \"small\";\n";
+
+	std::string source;
+	source.reserve(target_size + 1024);
+	while (source.size() < target_size) {
+		source += banner;
+		source += line_comment;
+		for (int i = 0; i < 4; ++i) {
+			source += literal;
+			source += "        \t\n";
+		}
+		source += code;
+	}
+	return source;
+}
+
+/*
+ *	@brief
+ *		Returns `line` repeated `count` times, for the benchmarks that run one statement shape many times over.
+ */
+std::string
+repeat_line(const std::string_view line, const size_t count)
+{
+	std::string source;
+	source.reserve(line.size() * count);
+	for (size_t index = 0; index < count; ++index) {
+		source += line;
+	}
+	return source;
+}
+
+void
+benchmark_scanner()
+{
+	constexpr size_t source_size = 64UL * 1024 * 1024;
+	const std::string source = make_generated_script(source_size);
+
+	std::cout << std::format("scanner ({} MiB generated script)\n", source.size() / (1024 * 1024));
+
+	size_t token_count = 0;
+	const double scan_ns = measure_ns([&] {
+		const Scanner scanner(source);
+		token_count = scanner.get_tokens().size();
+	});
+	g_sink = token_count;
+	report("Scanner", scan_ns, source.size(), "byte");
+	std::cout << std::format("  {:<40} {:>10.1f} MiB/s, {} tokens\n", "",
+		static_cast<double>(source.size()) / (1024.0 * 1024.0) / (scan_ns / 1e9), token_count);
+
+	const double parallel_ns = measure_ns([&] {
+		const Scanner scanner(source, ScanMode::PARALLEL);
+		token_count = scanner.get_tokens().size();
+	});
+	g_sink = token_count;
+	report(std::format("Scanner, parallel ({} hardware threads)", std::thread::hardware_concurrency()), parallel_ns,
+		source.size(), "byte");
+	std::cout << std::format("  {:<40} {:>10.1f} MiB/s, {} tokens\n", "",
+		static_cast<double>(source.size()) / (1024.0 * 1024.0) / (parallel_ns / 1e9), token_count);
+}
+
+// =====================================================================================================================
+// operators: lexing dense code, where per-character dispatch dominates.
+
+void
+benchmark_operators()
+{
+	constexpr size_t lines = 200'000;
+	const std::string line = "{ var a = (b1 + c2) * -d3 / e4; print a >= 1 and a != 2 or !(a <= 3) ? a == 4 : a < 5; }\n";
+	const std::string source = repeat_line(line, lines);
+
+	size_t token_count = 0;
+	const double scan_ns = measure_ns([&] {
+		const Scanner scanner(source);
+		token_count = scanner.get_tokens().size();
+	});
+	g_sink = token_count;
+
+	std::cout << std::format("operators ({} KiB, {} tokens)\n", source.size() / 1024, token_count);
+	report("Scanner", scan_ns, token_count, "token");
+}
+
+// =====================================================================================================================
+// numbers: lexing numeric-heavy data files (tables of constants).
+
+void
+benchmark_numbers()
+{
+	constexpr size_t rows = 400'000;
+	std::string source;
+	for (size_t row = 0; row < rows; ++row) {
+		source += std::format("var c{} = {}.{}, {}, {}.5, 0.{};\n", row, row * 7919, row % 1000, row, row * 31, row);
+	}
+
+	std::cout << std::format("numbers ({} rows, {} KiB)\n", rows, source.size() / 1024);
+
+	size_t token_count = 0;
+	const double scan_ns = measure_ns([&] {
+		const Scanner scanner(source);
+		token_count = scanner.get_tokens().size();
+	});
+	g_sink = token_count;
+	report("Scanner", scan_ns, rows, "row (4 numbers)");
+}
+
+// =====================================================================================================================
+// environment: variable lookups through nested scopes.
+
+void
+benchmark_environment()
+{
+	constexpr size_t name_count = 64;
+	constexpr size_t depth = 4;
+	constexpr size_t rounds = 100'000;
+	const size_t operations = rounds * name_count;
+
+	std::string source;
+	for (size_t index = 0; index < name_count; ++index) {
+		source += std::format("variable_{} ", index);
+	}
+	const Scanner scanner(source);
+	std::vector<Token> names;
+	for (size_t index = 0; index + 1 < scanner.get_tokens().size(); ++index) {
+		names.push_back(scanner.get_tokens().get_token(index));
+	}
+
+	// Globals hold every name; the lookups start `depth` scopes further in.
+	std::vector<std::unique_ptr<Environment>> scopes;
+	scopes.push_back(std::make_unique<Environment>());
+	for (const Token& name : names) {
+		scopes.front()->define(name, Value(1.0));
+	}
+	for (size_t level = 1; level < depth; ++level) {
+		scopes.push_back(std::make_unique<Environment>(scopes.back().get()));
+	}
+
+	// The previous implementation: maps keyed by a std::string copy of the lexeme.
+	std::vector<std::unordered_map<std::string, std::any>> string_scopes(depth);
+	for (const Token& name : names) {
+		string_scopes.front()[std::string(name.get_lexeme())] = std::any(1.0);
+	}
+
+	std::cout << std::format("environment ({} lookups, {} scopes deep)\n", operations, depth);
+
+	const double string_ns = measure_ns([&] {
+		size_t found = 0;
+		for (size_t round = 0; round < rounds; ++round) {
+			for (const Token& name : names) {
+				for (auto scope = string_scopes.rbegin(); scope != string_scopes.rend(); ++scope) {
+					const auto it = scope->find(std::string(name.get_lexeme()));
+					if (it != scope->end()) {
+						const std::any value = it->second;
+						found += value.has_value() ? 1 : 0;
+						break;
+					}
+				}
+			}
+		}
+		g_sink = found;
+	});
+	report("std::unordered_map<std::string>", string_ns, operations, "lookup");
+
+	const double symbol_ns = measure_ns([&] {
+		size_t found = 0;
+		for (size_t round = 0; round < rounds; ++round) {
+			for (const Token& name : names) {
+				found += scopes.back()->get(name).is_number() ? 1 : 0;
+			}
+		}
+		g_sink = found;
+	});
+	report("Environment (interned symbols)", symbol_ns, operations, "lookup");
+}
+
+// =====================================================================================================================
+// parse: scanning and parsing together, with the tokens materialized up front or pulled on demand.
+
+void
+benchmark_parse()
+{
+	constexpr size_t lines = 200'000;
+	const std::string line = "{ var a = (b1 + c2) * -d3 / e4; print a >= 1 == (a != 2); a = a + \"s\"; }\n";
+	const std::string source = repeat_line(line, lines);
+
+	size_t token_count = 0;
+	size_t statement_count = 0;
+	const double materialized_ns = measure_ns([&] {
+		Scanner scanner(source, ScanMode::SERIAL);
+		token_count = scanner.get_tokens().size();
+		Parser parser(scanner, false);
+		statement_count = parser.parse().size();
+	});
+	g_sink = statement_count;
+
+	// Type, offset, length and symbol of every token; the literal side table comes on top.
+	const size_t token_bytes = token_count * (sizeof(TokenType) + 2 * sizeof(uint32_t) + sizeof(SymbolId));
+	std::cout << std::format("parse ({} KiB, {} tokens)\n", source.size() / 1024, token_count);
+	report(std::format("SERIAL, {} MiB of tokens", token_bytes / (1024 * 1024)), materialized_ns, token_count, "token");
+
+	const double on_demand_ns = measure_ns([&] {
+		Scanner scanner(source, ScanMode::ON_DEMAND);
+		Parser parser(scanner, false);
+		statement_count = parser.parse().size();
+	});
+	g_sink = statement_count;
+	report("ON_DEMAND, one token at a time", on_demand_ns, token_count, "token");
+}
+
+// =====================================================================================================================
+// expressions: the parser alone on operator-dense expressions, where every operand descends through all precedence
+// levels and each level tests the current token against its operator set.
+
+void
+benchmark_expressions()
+{
+	constexpr size_t lines = 100'000;
+	const std::string line = "print (a + b * c - d / e) == (f >= g) != !(h < i + -j) == k <= l * (m - n) / o;\n";
+	const std::string source = repeat_line(line, lines);
+
+	// The tokens are scanned up front so that only parsing is timed.
+	Scanner scanner(source, ScanMode::SERIAL);
+	const size_t token_count = scanner.get_tokens().size();
+	size_t statement_count = 0;
+	const double parse_ns = measure_ns([&] {
+		Parser parser(scanner, false);
+		statement_count = parser.parse().size();
+	});
+	g_sink = statement_count;
+
+	std::cout << std::format("expressions ({} KiB, {} tokens)\n", source.size() / 1024, token_count);
+	report("Parser::parse", parse_ns, token_count, "token");
+}
+
+// =====================================================================================================================
+// errors: linting many small snippets that are mostly broken, with the diagnostics collected rather than printed.
+
+void
+benchmark_errors()
+{
+	constexpr size_t rounds = 20'000;
+	constexpr std::array snippets = {
+		"print (a + ;",
+		"var = 3; print a;",
+		"a = (b * c; var x = 1;",
+		"{ print 1 } print 2;",
+		"1 + * 2; print == 3;",
+		"var a = 1 print a;",
+		"{ { var b = (1 ? 2); } }",
+		"print a +; print b -; print c *;",
+		"var ok = (a + b) * c;",
+		"{ var x = 1; print x + (2 * 3); }",
+	};
+
+	std::vector<Diagnostic> diagnostics;
+	size_t statement_count = 0;
+	size_t snippet_count = 0;
+	const double lint_ns = measure_ns([&] {
+		const DiagnosticCapture capture(diagnostics);
+		for (size_t round = 0; round < rounds; ++round) {
+			for (const std::string_view snippet : snippets) {
+				diagnostics.clear();
+				Scanner scanner(snippet, ScanMode::ON_DEMAND);
+				Parser parser(scanner, false);
+				statement_count += parser.parse().size();
+				scanner.finish();
+				snippet_count++;
+			}
+		}
+	});
+	g_sink = statement_count + diagnostics.size();
+
+	std::cout << std::format("errors ({} snippets, 8 of 10 broken)\n", snippet_count);
+	report("Scanner + Parser, diagnostics collected", lint_ns, snippet_count, "snippet");
+}
+
+// =====================================================================================================================
+// allocations: heap allocations made while parsing, which should be exactly one per AST node.
+
+/*
+ *	@brief
+ *		Passes allocations through to `upstream`, counting them. Given to a `Parser`, it counts the syntax tree's nodes
+ *		however the upstream resource obtains its memory.
+ */
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+	explicit CountingResource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+		: m_upstream(upstream)
+	{
+	}
+
+	[[nodiscard]] size_t get_allocations() const { return m_allocations; }
+	[[nodiscard]] size_t get_bytes() const { return m_bytes; }
+
+private:
+	std::pmr::memory_resource* m_upstream;
+	size_t m_allocations = 0;
+	size_t m_bytes = 0;
+
+	void*
+	do_allocate(const size_t bytes, const size_t alignment) override
+	{
+		++m_allocations;
+		m_bytes += bytes;
+		return m_upstream->allocate(bytes, alignment);
+	}
+
+	void
+	do_deallocate(void* const pointer, const size_t bytes, const size_t alignment) override
+	{
+		m_upstream->deallocate(pointer, bytes, alignment);
+	}
+
+	[[nodiscard]] bool
+	do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+	{
+		return this == &other;
+	}
+};
+
+void
+benchmark_allocations()
+{
+	constexpr size_t statements = 100'000;
+	// Each statement is 7 tokens and 6 nodes: Print, two Binary and three Variable.
+	constexpr size_t nodes_per_statement = 6;
+	const std::string source = repeat_line("print alpha + beta * gamma;\n", statements);
+
+	CountingResource node_resource;
+	Scanner scanner(source, ScanMode::ON_DEMAND);
+	Parser parser(scanner, false, &node_resource);
+	// The result is reserved up front so that only the parser's own allocations are counted.
+	std::vector<std::shared_ptr<Stmt>> parsed;
+	parsed.reserve(statements);
+	// The first statement is not counted: it interns the identifiers and sizes the parser's buffers.
+	parsed.push_back(parser.parse_declaration());
+
+	const size_t before = g_allocations.load();
+	const size_t nodes_before = node_resource.get_allocations();
+	while (!parser.is_at_end()) {
+		parsed.push_back(parser.parse_declaration());
+	}
+	const size_t allocations = g_allocations.load() - before;
+	const size_t node_allocations = node_resource.get_allocations() - nodes_before;
+	g_sink = parsed.size();
+
+	// Every node comes from the parser's memory resource, and nothing else from the heap.
+	const size_t counted_statements = statements - 1;
+	std::cout << std::format("allocations ({} statements, {} tokens each)\n", statements, 7);
+	std::cout << std::format("  {:<40} {:>10.2f} allocations/statement\n", "Parser::parse_declaration",
+		static_cast<double>(allocations) / static_cast<double>(counted_statements));
+	std::cout << std::format("  {:<40} {:>10.2f} allocations/statement\n", "  from its memory resource",
+		static_cast<double>(node_allocations) / static_cast<double>(counted_statements));
+	std::cout << std::format("  {:<40} {:>10} nodes/statement\n", "", nodes_per_statement);
+	if (node_allocations != counted_statements * nodes_per_statement || allocations != node_allocations) {
+		std::cout << std::format("  FAILED: {} allocations, {} from the resource, for {} nodes\n", allocations,
+			node_allocations, counted_statements * nodes_per_statement);
+		g_check_failed = true;
+	}
+}
+
+// =====================================================================================================================
+// arena: a run's tokens and syntax tree allocated piecemeal from the heap, or from one arena released all at once.
+
+void
+benchmark_arena()
+{
+	constexpr size_t lines = 100'000;
+	const std::string line = "{ var a = (b1 + c2) * -d3 / e4; print a >= 1 == (a != 2); a = a + \"s\"; }\n";
+	const std::string source = repeat_line(line, lines);
+
+	size_t statement_count = 0;
+	const double heap_ns = measure_ns([&] {
+		Scanner scanner(source, ScanMode::SERIAL);
+		Parser parser(scanner, false);
+		statement_count += parser.parse().size();
+	});
+
+	size_t bytes_used = 0;
+	size_t bytes_reserved = 0;
+	const double arena_ns = measure_ns([&] {
+		Arena arena(source.size());
+		Scanner scanner(source, ScanMode::SERIAL, &arena);
+		Parser parser(scanner, false, &arena);
+		statement_count += parser.parse().size();
+		bytes_used = arena.get_bytes_used();
+		bytes_reserved = arena.get_bytes_reserved();
+	});
+	g_sink = statement_count;
+
+	std::cout << std::format("arena ({} statements, scanned, parsed and released)\n", lines);
+	report("heap", heap_ns, lines, "statement");
+	report(std::format("Arena, {} of {} MiB used", bytes_used >> 20U, bytes_reserved >> 20U), arena_ns, lines,
+		"statement");
+}
+
+// =====================================================================================================================
+// values: the interpreter on arithmetic and on strings, with the heap traffic that its values cause.
+
+void
+benchmark_values()
+{
+	constexpr size_t lines = 100'000;
+	struct Script {
+		std::string_view name;
+		std::string_view line;
+		size_t statements_per_line;
+	};
+	// A block counts as a statement of its own. The expressions script declares nothing, so evaluating it should
+	// not allocate at all.
+	constexpr std::array scripts = {
+		Script{"numbers", "{ var a = (b1 + c2) * -d3 / e4; var b = a >= 1 == (a != 2); c2 = c2 + 1; }\n", 4},
+		Script{"expressions", "c2 = (b1 + c2) * -d3 / e4 + 1; e4 = (c2 >= 1 == (c2 != 2) ? 4 : 5);\n", 2},
+		Script{"strings", "{ var a = s1 + s2; var b = a == s1; s2 = s1; }\n", 4},
+	};
+
+	std::cout << std::format("values ({} lines per script, {} bytes per Value)\n", lines, sizeof(Value));
+	for (const Script& script : scripts) {
+		std::string source = "var b1 = 1; var c2 = 2; var d3 = 3; var e4 = 4; var s1 = \"lox\"; var s2 = \"string\";\n";
+		source += repeat_line(script.line, lines);
+		Scanner scanner(source, ScanMode::SERIAL);
+		Parser parser(scanner, false);
+		const std::vector<std::shared_ptr<Stmt>> statements = parser.parse();
+
+		Interpreter interpreter;
+		const size_t allocations_before = g_allocations.load();
+		const size_t bytes_before = g_allocated_bytes.load();
+		const double interpret_ns = measure_ns([&] { interpreter.interpret(statements); });
+		const size_t statement_count = lines * script.statements_per_line;
+		report(std::format("Interpreter, {}", script.name), interpret_ns, statement_count, "statement");
+		std::cout << std::format("  {:<40} {:>10.2f} allocations/statement, {:.0f} bytes\n", "",
+			static_cast<double>(g_allocations.load() - allocations_before) / static_cast<double>(statement_count),
+			static_cast<double>(g_allocated_bytes.load() - bytes_before) / static_cast<double>(statement_count));
+	}
+}
+
+// =====================================================================================================================
+// strings: a script that builds a string of several MiB by appending to it one piece at a time.
+
+void
+benchmark_strings()
+{
+	const std::string piece = "\"" + std::string(62, 's') + "\"";
+	std::cout << std::format("strings (pieces of {} characters)\n", piece.size() - 2);
+
+	// The time per append stays flat as the string grows only if appending does not copy what is already there.
+	for (const size_t appends : std::array<size_t, 3>{25'000, 50'000, 100'000}) {
+		std::string source = "var s = \"\";\n";
+		source += repeat_line("s = s + " + piece + ";\n", appends);
+		Scanner scanner(source, ScanMode::SERIAL);
+		Parser parser(scanner, false);
+		const std::vector<std::shared_ptr<Stmt>> statements = parser.parse();
+
+		Interpreter interpreter;
+		const double interpret_ns = measure_ns([&] { interpreter.interpret(statements); });
+		const double mebibytes = static_cast<double>(appends * (piece.size() - 2)) / (1024.0 * 1024.0);
+		report(std::format("Interpreter, {:.1f} MiB string", mebibytes), interpret_ns, appends, "append");
+	}
+
+	// Appending an empty string shares the buffer; the text handed out for one of the two strings must not change
+	// when the other is appended to.
+	const Value original(std::string("ab"));
+	const Value alias = original + Value(std::string());
+	const std::string& text = original.as_string();
+	const Value appended = alias + Value(std::string("XYZ"));
+	if (text != "ab" || appended.as_string() != "abXYZ") {
+		std::cout << std::format("  FAILED: \"ab\" reads as \"{}\" once a string sharing its buffer is appended to\n",
+			text);
+		g_check_failed = true;
+	}
+}
+
+// =====================================================================================================================
+// format: turning numbers into text, as `print` does.
+
+// The previous implementation: `%f` with six decimals, then the trailing zeros trimmed.
+std::string
+format_fixed_six(const double number)
+{
+	std::string text = std::to_string(number);
+	if (text.find('.') != std::string::npos) {
+		text.erase(text.find_last_not_of('0') + 1);
+		if (text.back() == '.') {
+			text.pop_back();
+		}
+	}
+	return text;
+}
+
+void
+benchmark_format()
+{
+	constexpr size_t count = 1'000'000;
+	// Integers, short fractions, and results of division that need all seventeen digits.
+	constexpr std::array divisors = {1.0, 4.0, 7.0};
+	std::vector<double> numbers;
+	numbers.reserve(count);
+	for (size_t index = 0; index < count; ++index) {
+		numbers.push_back(static_cast<double>(index) / divisors.at(index % divisors.size()));
+	}
+
+	std::cout << std::format("format ({} numbers)\n", count);
+	const auto measure = [&](const std::string_view name, const auto& format) {
+		size_t characters = 0;
+		const size_t allocations_before = g_allocations.load();
+		const double format_ns = measure_ns([&] {
+			for (const double number : numbers) {
+				characters += format(number);
+			}
+		});
+		g_sink = characters;
+		report(name, format_ns, count, "number");
+		std::cout << std::format("  {:<40} {:>10.2f} allocations/number\n", "",
+			static_cast<double>(g_allocations.load() - allocations_before) / static_cast<double>(count));
+	};
+	measure("std::to_string, zeros trimmed", [](const double number) { return format_fixed_six(number).size(); });
+	measure("Value::to_string", [](const double number) { return Value(number).to_string().size(); });
+	measure("Value::format_number", [](const double number) {
+		Value::NumberBuffer buffer{};
+		return Value::format_number(number, buffer).size();
+	});
+}
+
+// =====================================================================================================================
+// edit: diagnostics after a keystroke in a large file, as editor tooling requests them.
+
+void
+benchmark_edit()
+{
+	constexpr size_t lines = 100'000;
+	constexpr size_t keystrokes = 2'000;
+
+	std::string source;
+	for (size_t line = 0; line < lines; ++line) {
+		if (line % 10 == 9) {
+			source += std::format("{{ var t{} = v{} * 2; print t{} >= 100; }}\n", line, line - 1, line);
+		} else {
+			const size_t previous = line == 0 ? 0 : line - 1;
+			source += std::format("var v{} = (v{} + {}) * 3 - {} / 7;\n", line, previous, line, line % 97);
+		}
+	}
+
+	std::cout << std::format("edit ({} lines, {} KiB, {} keystrokes)\n", lines, source.size() / 1024, keystrokes);
+
+	size_t statement_count = 0;
+	const double full_ns = measure_ns([&] {
+		Scanner scanner(source, ScanMode::ON_DEMAND);
+		Parser parser(scanner, false);
+		statement_count = parser.parse().size();
+	});
+	g_sink = statement_count;
+	report("Scanner + Parser, whole file", full_ns, 1, "run");
+
+	std::unique_ptr<IncrementalFrontEnd> front_end;
+	const double build_ns = measure_ns([&] { front_end = std::make_unique<IncrementalFrontEnd>(source); });
+	report("IncrementalFrontEnd, initial parse", build_ns, 1, "run");
+
+	// Type a character into the first identifier of a line, then delete it again; both edits are timed.
+	std::vector<size_t> positions;
+	for (size_t index = 0; index < keystrokes; ++index) {
+		const size_t position = (index * 7919 % lines) * (source.size() / lines);
+		positions.push_back(source.find('v', source.find('\n', position)));
+	}
+	size_t reparsed = 0;
+	const double edit_ns = measure_ns([&] {
+		for (const size_t position : positions) {
+			front_end->edit(position + 1, 0, "x");
+			reparsed += front_end->get_reparsed_count();
+			front_end->edit(position + 1, 1, "");
+			reparsed += front_end->get_reparsed_count();
+		}
+	});
+	g_sink = reparsed + front_end->get_diagnostics().size();
+	report("IncrementalFrontEnd::edit", edit_ns, keystrokes * 2, "edit");
+	std::cout << std::format("  {:<40} {:>10.2f} declarations/edit\n", "",
+		static_cast<double>(reparsed) / static_cast<double>(keystrokes * 2));
+
+	// Open a string that swallows the rest of the file, then close it again.
+	const size_t middle = source.find('\n', source.size() / 2) + 1;
+	const double string_ns = measure_ns([&] {
+		front_end->edit(middle, 0, "\"");
+		front_end->edit(middle, 1, "");
+	});
+	g_sink = front_end->get_diagnostics().size();
+	report("IncrementalFrontEnd::edit, unterminated string", string_ns, 2, "edit");
+}
+
+// =====================================================================================================================
+
+struct Benchmark {
+	std::string_view name;
+	void (*run)();
+};
+
+constexpr std::array benchmarks = {
+	Benchmark{"keywords", benchmark_keywords},
+	Benchmark{"scanner", benchmark_scanner},
+	Benchmark{"operators", benchmark_operators},
+	Benchmark{"numbers", benchmark_numbers},
+	Benchmark{"environment", benchmark_environment},
+	Benchmark{"parse", benchmark_parse},
+	Benchmark{"expressions", benchmark_expressions},
+	Benchmark{"errors", benchmark_errors},
+	Benchmark{"allocations", benchmark_allocations},
+	Benchmark{"arena", benchmark_arena},
+	Benchmark{"values", benchmark_values},
+	Benchmark{"strings", benchmark_strings},
+	Benchmark{"format", benchmark_format},
+	Benchmark{"edit", benchmark_edit},
+};
+
+} // namespace
+
+// =====================================================================================================================
+// Replacements of the global allocation functions that count allocations. libstdc++'s array forms forward to the
+// plain and aligned forms, but its aligned and nothrow forms do not forward to the plain one, so each is replaced.
+// The default memory resource, and with it every std::pmr container and allocate_shared, uses the aligned form.
+
+namespace {
+
+void*
+allocate_counted(const size_t size, const size_t alignment)
+{
+	g_allocations.fetch_add(1, std::memory_order_relaxed);
+	g_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+	const size_t nonzero_size = std::max(size, size_t{1});
+	void* memory = nullptr;
+	if (alignment <= alignof(std::max_align_t)) {
+		memory = std::malloc(nonzero_size); // NOLINT(cppcoreguidelines-no-malloc)
+	} else {
+		// std::aligned_alloc only accepts sizes that are a multiple of the alignment.
+		memory = std::aligned_alloc(alignment, (nonzero_size + alignment - 1) / alignment * alignment);
+	}
+	if (memory == nullptr) {
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+} // namespace
+
+void*
+operator new(const size_t size)
+{
+	return allocate_counted(size, alignof(std::max_align_t));
+}
+
+void*
+operator new(const size_t size, const std::align_val_t alignment)
+{
+	return allocate_counted(size, static_cast<size_t>(alignment));
+}
+
+void*
+operator new(const size_t size, const std::nothrow_t& /*tag*/) noexcept
+{
+	try {
+		return allocate_counted(size, alignof(std::max_align_t));
+	} catch (const std::bad_alloc&) {
+		return nullptr;
+	}
+}
+
+void*
+operator new(const size_t size, const std::align_val_t alignment, const std::nothrow_t& /*tag*/) noexcept
+{
+	try {
+		return allocate_counted(size, static_cast<size_t>(alignment));
+	} catch (const std::bad_alloc&) {
+		return nullptr;
+	}
+}
+
+void
+operator delete(void* const memory) noexcept
+{
+	std::free(memory); // NOLINT(cppcoreguidelines-no-malloc)
+}
+
+void
+operator delete(void* const memory, const size_t /*size*/) noexcept
+{
+	std::free(memory); // NOLINT(cppcoreguidelines-no-malloc)
+}
+
+void
+operator delete(void* const memory, const std::align_val_t /*alignment*/) noexcept
+{
+	std::free(memory); // NOLINT(cppcoreguidelines-no-malloc)
+}
+
+void
+operator delete(void* const memory, const size_t /*size*/, const std::align_val_t /*alignment*/) noexcept
+{
+	std::free(memory); // NOLINT(cppcoreguidelines-no-malloc)
+}
+
+// =====================================================================================================================
+
+int
+main(const int argc, const char* const argv[])
+{
+	const std::vector<std::string_view> args(argv, argv + argc);
+	require_action_return_value(args.size() <= 2, std::cout << "Usage: lox_benchmark [benchmark-name]" << std::endl, 1);
+
+	bool ran = false;
+	for (const Benchmark& benchmark : benchmarks) {
+		if (args.size() == 1 || args[1] == benchmark.name) {
+			benchmark.run();
+			ran = true;
+		}
+	}
+	require_action_return_value(ran, std::cout << std::format("Unknown benchmark: {}", args[1]) << std::endl, 1);
+	return g_check_failed ? 1 : 0;
+}
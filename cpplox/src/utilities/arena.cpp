@@ -0,0 +1,79 @@
+#include "arena.h"
+
+#include <cstddef>
+#include <memory_resource>
+
+// =====================================================================================================================
+// Constructors
+
+Arena::Arena(const size_t initial_size) : m_buffer(initial_size, &m_upstream)
+{
+	// Empty constructor.
+}
+
+Arena::~Arena() = default;
+
+// =====================================================================================================================
+// Public methods
+
+size_t
+Arena::get_bytes_used() const
+{
+	return m_bytes_used;
+}
+
+size_t
+Arena::get_bytes_reserved() const
+{
+	return m_upstream.get_bytes_reserved();
+}
+
+// =====================================================================================================================
+// Private methods
+
+void*
+Arena::do_allocate(const size_t bytes, const size_t alignment)
+{
+	m_bytes_used += bytes;
+	return m_buffer.allocate(bytes, alignment);
+}
+
+void
+Arena::do_deallocate(void* /*pointer*/, size_t /*bytes*/, size_t /*alignment*/)
+{
+	// Memory is only released with the arena.
+}
+
+bool
+Arena::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+	return this == &other;
+}
+
+// =====================================================================================================================
+// Upstream
+
+size_t
+Arena::Upstream::get_bytes_reserved() const
+{
+	return m_bytes_reserved;
+}
+
+void*
+Arena::Upstream::do_allocate(const size_t bytes, const size_t alignment)
+{
+	m_bytes_reserved += bytes;
+	return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void
+Arena::Upstream::do_deallocate(void* const pointer, const size_t bytes, const size_t alignment)
+{
+	std::pmr::new_delete_resource()->deallocate(pointer, bytes, alignment);
+}
+
+bool
+Arena::Upstream::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+	return this == &other;
+}
@@ -0,0 +1,56 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory_resource>
+
+/*
+ *	@brief
+ *		A memory resource for the objects of one run: the tokens and syntax tree nodes of a single `Lox::run`. Memory
+ *		is carved from a few large blocks and never reused; deallocating is a no-op, and everything is returned to the
+ *		heap at once when the arena is destroyed. Objects allocated from it must not outlive it.
+ *
+ *		Like the `std::pmr::monotonic_buffer_resource` it wraps, an arena is not thread-safe.
+ */
+class Arena : public std::pmr::memory_resource
+{
+public:
+	// `initial_size` is the size of the first block taken from the heap; later blocks grow geometrically.
+	explicit Arena(size_t initial_size);
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+	Arena(Arena&&) = delete;
+	Arena& operator=(Arena&&) = delete;
+	~Arena() override;
+
+	// Bytes handed out so far.
+	[[nodiscard]] size_t get_bytes_used() const;
+
+	// Bytes taken from the heap so far, including what is left of the current block.
+	[[nodiscard]] size_t get_bytes_reserved() const;
+
+private:
+	// Passes the arena's blocks through to the heap, counting them.
+	class Upstream : public std::pmr::memory_resource
+	{
+	public:
+		[[nodiscard]] size_t get_bytes_reserved() const;
+
+	private:
+		size_t m_bytes_reserved = 0;
+
+		void* do_allocate(size_t bytes, size_t alignment) override;
+		void do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+		[[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+	};
+
+	Upstream m_upstream;
+	std::pmr::monotonic_buffer_resource m_buffer;
+	size_t m_bytes_used = 0;
+
+	void* do_allocate(size_t bytes, size_t alignment) override;
+	void do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+	[[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+};
+
+#endif // ARENA_H
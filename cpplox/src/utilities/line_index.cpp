@@ -0,0 +1,52 @@
+#include "line_index.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <string_view>
+
+#include "general.h"
+#include "utilities/scan_kernels.h"
+
+// =====================================================================================================================
+// Constructors
+
+LineIndex::LineIndex(const std::string_view source) : m_source(source)
+{
+	// Left blank intentionally: the index is built on the first lookup.
+}
+
+// =====================================================================================================================
+// Public methods
+
+SourceLocation
+LineIndex::locate(const size_t offset)
+{
+	require_assert(offset <= m_source.size());
+	if (m_line_starts.empty()) {
+		build();
+	}
+	// The last line start at or before `offset`.
+	const auto line = std::ranges::upper_bound(m_line_starts, offset) - 1;
+	return {static_cast<size_t>(std::distance(m_line_starts.begin(), line)) + 1, offset - *line + 1};
+}
+
+size_t
+LineIndex::get_line(const size_t offset)
+{
+	return locate(offset).line;
+}
+
+// =====================================================================================================================
+// Private methods
+
+void
+LineIndex::build()
+{
+	m_line_starts.reserve(scan_kernels::count_newlines(m_source) + 1);
+	m_line_starts.push_back(0);
+	for (size_t pos = scan_kernels::find_line_end(m_source, 0); pos < m_source.size();
+		 pos = scan_kernels::find_line_end(m_source, pos + 1)) {
+		m_line_starts.push_back(pos + 1);
+	}
+}
@@ -0,0 +1,38 @@
+#ifndef LINE_INDEX_H
+#define LINE_INDEX_H
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+// A 1-based line and column.
+struct SourceLocation {
+	size_t line;
+	size_t column;
+};
+
+/*
+ *	@brief
+ *		Maps byte offsets of a source buffer to lines and columns. The table of line starts is only built on the first
+ *		lookup, so sources that never report an error never pay for it. The source must outlive the index.
+ */
+class LineIndex
+{
+public:
+	LineIndex() = default;
+	explicit LineIndex(std::string_view source);
+
+	// Locates the byte at `offset`; `source.size()` is accepted and lies past the last byte.
+	[[nodiscard]] SourceLocation locate(size_t offset);
+	[[nodiscard]] size_t get_line(size_t offset);
+
+private:
+	std::string_view m_source;
+
+	// Offset of the first byte of every line; empty until the first lookup.
+	std::vector<size_t> m_line_starts;
+
+	void build();
+};
+
+#endif // LINE_INDEX_H
@@ -0,0 +1,102 @@
+#include "mapped_file.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <ios>
+#include <string>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "general.h"
+
+// =====================================================================================================================
+// Constructors
+
+MappedFile::MappedFile(const std::string& path)
+{
+	const int file_descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC); // NOLINT(cppcoreguidelines-pro-type-vararg)
+	require_throw(file_descriptor >= 0,
+		std::ios_base::failure(fmt_str("Failed to open file: %s (%s)", path.c_str(), std::strerror(errno))));
+
+	struct stat file_stat = {};
+	const bool is_regular = ::fstat(file_descriptor, &file_stat) == 0 && S_ISREG(file_stat.st_mode);
+
+	// `mmap` rejects zero-length mappings, and an empty file has nothing to map anyway.
+	if (is_regular && file_stat.st_size > 0) {
+		const auto size = static_cast<size_t>(file_stat.st_size);
+		void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+		if (mapping != MAP_FAILED) { // NOLINT(cppcoreguidelines-pro-type-cstyle-cast, performance-no-int-to-ptr)
+			// The scanner walks the buffer front to back exactly once.
+			(void)::madvise(mapping, size, MADV_SEQUENTIAL);
+			m_mapping = mapping;
+			m_size = size;
+		}
+	}
+
+	if (m_mapping == nullptr && !(is_regular && file_stat.st_size == 0)) {
+		try {
+			read_into_buffer(file_descriptor, path);
+		} catch (...) {
+			(void)::close(file_descriptor);
+			throw;
+		}
+	}
+
+	// The mapping stays valid after the descriptor is closed.
+	(void)::close(file_descriptor);
+}
+
+// =====================================================================================================================
+// Destructor
+
+MappedFile::~MappedFile()
+{
+	if (m_mapping != nullptr) {
+		(void)::munmap(m_mapping, m_size);
+	}
+}
+
+// =====================================================================================================================
+// Public methods
+
+std::string_view
+MappedFile::get_content() const
+{
+	if (m_mapping != nullptr) {
+		return {static_cast<const char*>(m_mapping), m_size};
+	}
+	return m_buffer;
+}
+
+bool
+MappedFile::is_mapped() const
+{
+	return m_mapping != nullptr;
+}
+
+// =====================================================================================================================
+// Private methods
+
+void
+MappedFile::read_into_buffer(const int file_descriptor, const std::string& path)
+{
+	constexpr size_t chunk_size = 64 * 1024;
+	while (true) {
+		const size_t old_size = m_buffer.size();
+		m_buffer.resize(old_size + chunk_size);
+		const ssize_t count = ::read(file_descriptor, m_buffer.data() + old_size, chunk_size);
+		if (count < 0 && errno == EINTR) {
+			m_buffer.resize(old_size);
+			continue;
+		}
+		require_throw(count >= 0,
+			std::ios_base::failure(fmt_str("Failed to read file: %s (%s)", path.c_str(), std::strerror(errno))));
+		m_buffer.resize(old_size + static_cast<size_t>(count));
+		if (count == 0) {
+			return;
+		}
+	}
+}
@@ -0,0 +1,35 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/*
+ *	@brief
+ *		A read-only view of a file's content. Regular files are `mmap`ed, so the bytes are backed by the page cache
+ *		rather than copied onto the heap; anything that cannot be mapped (pipes, character devices, ...) is read into an
+ *		owned buffer instead. The content stays valid for the lifetime of the object.
+ */
+class MappedFile
+{
+public:
+	explicit MappedFile(const std::string& path);
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&&) = delete;
+	MappedFile& operator=(MappedFile&&) = delete;
+
+	[[nodiscard]] std::string_view get_content() const;
+	[[nodiscard]] bool is_mapped() const;
+
+private:
+	void* m_mapping = nullptr;
+	size_t m_size = 0;
+	std::string m_buffer;
+
+	void read_into_buffer(int file_descriptor, const std::string& path);
+};
+
+#endif // MAPPED_FILE_H
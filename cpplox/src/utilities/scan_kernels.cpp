@@ -0,0 +1,214 @@
+#include "scan_kernels.h"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+	#include <immintrin.h>
+#endif
+
+namespace {
+
+// =====================================================================================================================
+// Vector width abstraction. `eq` returns one bit per byte lane that equals `byte`.
+
+#if defined(__AVX2__)
+
+struct Lanes {
+	static constexpr size_t width = 32;
+	static constexpr uint32_t all = 0xFFFF'FFFFU;
+	using Register = __m256i;
+
+	static Register load(const char* data)
+	{
+		return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	}
+
+	static uint32_t eq(const Register block, const char byte)
+	{
+		return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, _mm256_set1_epi8(byte))));
+	}
+};
+
+#elif defined(__SSE2__)
+
+struct Lanes {
+	static constexpr size_t width = 16;
+	static constexpr uint32_t all = 0xFFFFU;
+	using Register = __m128i;
+
+	static Register load(const char* data)
+	{
+		return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)); // NOLINT(cppcoreguidelines-pro-type-reinterpret-cast)
+	}
+
+	static uint32_t eq(const Register block, const char byte)
+	{
+		return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8(byte))));
+	}
+};
+
+#else
+
+// Scalar builds never load blocks; this only keeps the kernels' vector predicates well-formed.
+struct Lanes {
+	static constexpr size_t width = 0;
+	static constexpr uint32_t all = 0;
+	using Register = int;
+
+	static Register load(const char* /*data*/)
+	{
+		return 0;
+	}
+
+	static uint32_t eq(const Register /*block*/, const char /*byte*/)
+	{
+		return 0;
+	}
+};
+
+#endif
+
+// =====================================================================================================================
+
+/*
+ *	@brief
+ *		Advances from `pos` to the first position for which `is_stop` holds.
+ *
+ *	@tparam T_Lookahead
+ *		How many bytes past a position the predicates may read.
+ *
+ *	@param stop_mask
+ *		Vector predicate: maps the block starting at the given pointer to a bit mask of its stop positions.
+ *
+ *	@param is_stop
+ *		Scalar predicate with the same meaning, used for the tail (and for the whole input without SIMD).
+ */
+template <size_t T_Lookahead = 0, typename T_StopMask, typename T_IsStop>
+size_t
+scan_until(const std::string_view text, size_t pos, T_StopMask stop_mask, T_IsStop is_stop)
+{
+	const char* const data = text.data();
+	const size_t size = text.size();
+
+#if defined(__AVX2__) || defined(__SSE2__)
+	while (pos + Lanes::width + T_Lookahead <= size) {
+		const uint32_t stops = stop_mask(data + pos);
+		if (stops != 0) {
+			return pos + static_cast<size_t>(std::countr_zero(stops));
+		}
+		pos += Lanes::width;
+	}
+#else
+	(void)data;
+	(void)stop_mask;
+#endif
+
+	while (pos < size && !is_stop(pos)) {
+		pos++;
+	}
+	return pos;
+}
+
+} // namespace
+
+namespace scan_kernels {
+
+// =====================================================================================================================
+
+size_t
+skip_whitespace(const std::string_view text, const size_t pos)
+{
+	return scan_until(
+		text, pos,
+		[](const char* block_start) {
+			const Lanes::Register block = Lanes::load(block_start);
+			const uint32_t blanks =
+				Lanes::eq(block, ' ') | Lanes::eq(block, '\t') | Lanes::eq(block, '\r') | Lanes::eq(block, '\n');
+			return ~blanks & Lanes::all;
+		},
+		[text](const size_t at) {
+			const char ch = text[at];
+			return ch != ' ' && ch != '\t' && ch != '\r' && ch != '\n';
+		});
+}
+
+// =====================================================================================================================
+
+size_t
+find_line_end(const std::string_view text, const size_t pos)
+{
+	return scan_until(
+		text, pos, [](const char* block_start) { return Lanes::eq(Lanes::load(block_start), '\n'); },
+		[text](const size_t at) { return text[at] == '\n'; });
+}
+
+// =====================================================================================================================
+
+size_t
+find_string_end(const std::string_view text, const size_t pos)
+{
+	return scan_until(
+		text, pos, [](const char* block_start) { return Lanes::eq(Lanes::load(block_start), '"'); },
+		[text](const size_t at) { return text[at] == '"'; });
+}
+
+// =====================================================================================================================
+
+size_t
+find_quote_or_slash(const std::string_view text, const size_t pos)
+{
+	return scan_until(
+		text, pos,
+		[](const char* block_start) {
+			const Lanes::Register block = Lanes::load(block_start);
+			return Lanes::eq(block, '"') | Lanes::eq(block, '/');
+		},
+		[text](const size_t at) { return text[at] == '"' || text[at] == '/'; });
+}
+
+// =====================================================================================================================
+
+size_t
+find_comment_delimiter(const std::string_view text, const size_t pos)
+{
+	// Compare each byte with its successor by loading the block a second time, shifted by one byte.
+	return scan_until<1>(
+		text, pos,
+		[](const char* block_start) {
+			const Lanes::Register block = Lanes::load(block_start);
+			const Lanes::Register next = Lanes::load(block_start + 1);
+			return (Lanes::eq(block, '/') & Lanes::eq(next, '*')) | (Lanes::eq(block, '*') & Lanes::eq(next, '/'));
+		},
+		[text](const size_t at) {
+			if (at + 1 >= text.size()) {
+				return false;
+			}
+			return (text[at] == '/' && text[at + 1] == '*') || (text[at] == '*' && text[at + 1] == '/');
+		});
+}
+
+// =====================================================================================================================
+
+size_t
+count_newlines(const std::string_view text)
+{
+	const char* const data = text.data();
+	size_t newlines = 0;
+	size_t pos = 0;
+
+#if defined(__AVX2__) || defined(__SSE2__)
+	for (; pos + Lanes::width <= text.size(); pos += Lanes::width) {
+		newlines += static_cast<size_t>(std::popcount(Lanes::eq(Lanes::load(data + pos), '\n')));
+	}
+#endif
+
+	for (; pos < text.size(); ++pos) {
+		newlines += data[pos] == '\n' ? 1 : 0;
+	}
+	return newlines;
+}
+
+} // namespace scan_kernels
@@ -0,0 +1,36 @@
+#ifndef SCAN_KERNELS_H
+#define SCAN_KERNELS_H
+
+#include <cstddef>
+#include <string_view>
+
+/*
+ *	Bulk byte-scanning kernels used by the scanner's hot loops (whitespace runs, comments and string bodies).
+ *
+ *	Each kernel starts at `pos` and returns the position of the first byte that stops it (or `text.size()`). The
+ *	kernels use AVX2 when the build enables it (CPPLOX_ENABLE_AVX2), SSE2 on other x86-64 builds and a scalar loop
+ *	everywhere else.
+ */
+namespace scan_kernels {
+
+// Skips ' ', '\t', '\r' and '\n'.
+[[nodiscard]] size_t skip_whitespace(std::string_view text, size_t pos);
+
+// Finds the next '\n', e.g. the one that ends a line comment.
+[[nodiscard]] size_t find_line_end(std::string_view text, size_t pos);
+
+// Finds the closing '"' of a string literal.
+[[nodiscard]] size_t find_string_end(std::string_view text, size_t pos);
+
+// Finds the next '"' or '/', i.e. a place where a string or a comment may start.
+[[nodiscard]] size_t find_quote_or_slash(std::string_view text, size_t pos);
+
+// Finds the next "/*" or "*/" delimiter inside a block comment.
+[[nodiscard]] size_t find_comment_delimiter(std::string_view text, size_t pos);
+
+// Counts the '\n' bytes in `text`.
+[[nodiscard]] size_t count_newlines(std::string_view text);
+
+} // namespace scan_kernels
+
+#endif // SCAN_KERNELS_H
@@ -1,7 +1,14 @@
 #include "value.h"
 #include "general.h"
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <functional>
 #include <stdexcept>
-#include <variant>
+#include <string_view>
+#include <system_error>
+#include <utility>
 
 namespace {
 
@@ -18,136 +25,292 @@ value_type_to_string(ValueType type)
 	ignore_warning_end();
 }
 
-void
-remove_trailing_zeros(std::string& str)
+} // namespace
+
+// =====================================================================================================================
+// String objects
+
+/*
+ *	@brief
+ *		The text of a string value: the first `m_length` characters of a buffer shared by strings built from one
+ *		another. Concatenating onto the string that ends its buffer appends to the buffer in place, so building a
+ *		string piece by piece copies each piece once rather than the whole string every time. The strings it was built
+ *		from still see their own prefix of the buffer.
+ *
+ *		`get_text` has to return a whole `std::string`, so a string that does not end its buffer first copies its
+ *		prefix into a buffer of its own. Its buffer is then pinned: no string sharing it ever appends to it in place
+ *		again, so the text handed out neither changes nor moves.
+ *
+ *		The reference counts are not atomic: a value is only ever used by one thread at a time. Values made by the
+ *		parallel scanner's workers are handed over once the workers are done with them.
+ */
+class Value::StringObject
 {
-	const size_t dot_pos = str.find('.');
-	if (dot_pos != std::string::npos) {
-		size_t end = str.size() - 1;
-		while (str[end] == '0') {
-			--end;
+public:
+	explicit StringObject(std::string&& text)
+		: m_buffer(new Buffer(std::move(text))), m_length(m_buffer->text.size()) // NOLINT
+	{
+	}
+
+	StringObject(const StringObject&) = delete;
+	StringObject(StringObject&&) = delete;
+	StringObject& operator=(const StringObject&) = delete;
+	StringObject& operator=(StringObject&&) = delete;
+	~StringObject() { release_buffer(); }
+
+	void retain() { ++m_reference_count; }
+
+	// Drops a reference, and returns whether it was the last one.
+	[[nodiscard]] bool release() { return --m_reference_count == 0; }
+
+	[[nodiscard]] std::string_view get_view() const { return {m_buffer->text.data(), m_length}; }
+
+	// Computed the first time it is needed, to reject unequal strings of the same length quickly.
+	[[nodiscard]] size_t
+	get_hash()
+	{
+		if (!m_is_hashed) {
+			m_hash = std::hash<std::string_view>{}(get_view());
+			m_is_hashed = true;
 		}
-		if (str[end] == '.') {
-			--end;
+		return m_hash;
+	}
+
+	[[nodiscard]] const std::string&
+	get_text()
+	{
+		if (m_buffer->text.size() != m_length) {
+			Buffer* const own_buffer = new Buffer(std::string(get_view())); // NOLINT(cppcoreguidelines-owning-memory)
+			release_buffer();
+			m_buffer = own_buffer;
 		}
-		str = str.substr(0, end + 1);
+		// The caller holds a reference to the buffer from now on, so it must not grow under them, whichever of the
+		// strings sharing it is appended to.
+		m_buffer->is_pinned = true;
+		return m_buffer->text;
 	}
-}
 
-} // namespace
+	// Returns a new string object of this text followed by `text`, with a reference for the caller.
+	[[nodiscard]] StringObject*
+	append(const std::string_view text)
+	{
+		std::string& buffer = m_buffer->text;
+		// `text` may itself lie in the buffer, which appending can move.
+		const bool is_in_buffer = std::greater_equal<>{}(text.data(), buffer.data()) &&
+								  std::less<>{}(text.data(), buffer.data() + buffer.size());
+		if (buffer.size() == m_length && !m_buffer->is_pinned && !is_in_buffer) {
+			buffer.append(text);
+			++m_buffer->reference_count;
+			return new StringObject(m_buffer, buffer.size()); // NOLINT(cppcoreguidelines-owning-memory)
+		}
+		std::string joined;
+		joined.reserve(m_length + text.size());
+		joined.append(get_view()).append(text);
+		return new StringObject(std::move(joined)); // NOLINT(cppcoreguidelines-owning-memory)
+	}
+
+private:
+	struct Buffer {
+		explicit Buffer(std::string buffer_text) : text(std::move(buffer_text)) {}
+
+		std::string text;
+		size_t reference_count = 1;
+		// Set once `get_text` has handed the text out.
+		bool is_pinned = false;
+		CLASS_PADDING(7);
+	};
 
+	Buffer* m_buffer;
+	size_t m_length;
+	size_t m_hash = 0;
+	size_t m_reference_count = 1;
+	bool m_is_hashed = false;
+	CLASS_PADDING(7);
+
+	StringObject(Buffer* buffer, const size_t length) : m_buffer(buffer), m_length(length) {}
+
+	void
+	release_buffer()
+	{
+		if (--m_buffer->reference_count == 0) {
+			delete m_buffer; // NOLINT(cppcoreguidelines-owning-memory)
+		}
+	}
+};
+
+// =====================================================================================================================
 // Constructors
 
-Value::Value() : m_type(ValueType::NIL) {}
-Value::Value(bool value) : m_value(value), m_type(ValueType::BOOL) {}
-Value::Value(int value) : m_value(value), m_type(ValueType::NUMBER) {}
-Value::Value(double value) : m_value(value), m_type(ValueType::NUMBER) {}
-Value::Value(const std::string& value) : m_value(value), m_type(ValueType::STRING) {}
+Value::Value() : m_bits(nil_bits) {}
+Value::Value(bool value) : m_bits(value ? true_bits : false_bits) {}
+Value::Value(int value) : Value(static_cast<double>(value)) {}
 
-// Public methods
+Value::Value(double value) : m_bits(std::bit_cast<std::uint64_t>(value))
+{
+	// A NaN's payload could collide with a tag, so only its sign is kept; that is all that printing shows of it.
+	if (std::isnan(value)) {
+		constexpr std::uint64_t canonical_nan = 0x7ff8'0000'0000'0000;
+		m_bits = (m_bits & sign_bit) | canonical_nan;
+	}
+}
 
-[[nodiscard]] bool
-Value::is_nil() const
+Value::Value(const std::string& value) : Value(std::string(value)) {}
+Value::Value(std::string&& value) : Value(new StringObject(std::move(value))) {} // NOLINT
+
+Value::Value(StringObject* string) : m_bits(string_tag | reinterpret_cast<std::uintptr_t>(string)) // NOLINT
 {
-	return std::holds_alternative<std::monostate>(m_value);
+	// User-space addresses fit in the 48 bits below the tag on every 64-bit target we build for.
+	require_assert(get_string() == string);
 }
 
-[[nodiscard]] bool
-Value::is_bool() const
+Value::Value(const Value& other) : m_bits(other.m_bits)
 {
-	return std::holds_alternative<bool>(m_value);
+	if (is_string()) {
+		get_string()->retain();
+	}
 }
 
-[[nodiscard]] bool
-Value::is_number() const
+Value::Value(Value&& other) noexcept : m_bits(std::exchange(other.m_bits, nil_bits)) {}
+
+Value&
+Value::operator=(const Value& other)
 {
-	return std::holds_alternative<double>(m_value);
+	if (this != &other) {
+		*this = Value(other);
+	}
+	return *this;
 }
 
-[[nodiscard]] bool
-Value::is_string() const
+Value&
+Value::operator=(Value&& other) noexcept
 {
-	return std::holds_alternative<std::string>(m_value);
+	if (this != &other) {
+		release();
+		m_bits = std::exchange(other.m_bits, nil_bits);
+	}
+	return *this;
 }
 
+Value::~Value()
+{
+	release();
+}
+
+// Public methods
+
 [[nodiscard]] ValueType
 Value::get_type() const
 {
-	return m_type;
+	if (is_number()) {
+		return ValueType::NUMBER;
+	}
+	if (is_string()) {
+		return ValueType::STRING;
+	}
+	return is_nil() ? ValueType::NIL : ValueType::BOOL;
 }
 
 [[nodiscard]] bool
 Value::as_bool() const
 {
-	return std::get<bool>(m_value);
+	require_throw(is_bool(), std::runtime_error("Value is not a bool"));
+	return m_bits == true_bits;
 }
 
 [[nodiscard]] double
 Value::as_number() const
 {
 	require_throw(is_number(), std::runtime_error("Value is not a number"));
-	return std::get<double>(m_value);
+	return std::bit_cast<double>(m_bits);
 }
+
 [[nodiscard]] const std::string&
 Value::as_string() const
 {
-
-	return std::get<std::string>(m_value);
+	require_throw(is_string(), std::runtime_error("Value is not a string"));
+	return get_string()->get_text();
 }
 
 [[nodiscard]] std::string
 Value::to_string() const
 {
-	return std::visit(
-		[](const auto& arg) -> std::string {
-			// Getting the original template type T of the variant.
-			using T = std::decay_t<decltype(arg)>;
-
-			if constexpr (std::is_same_v<T, std::monostate>) {
-				return "nil";
-			} else if constexpr (std::is_same_v<T, bool>) {
-				return arg ? "true" : "false";
-			} else if constexpr (std::is_same_v<T, int>) {
-				return std::to_string(arg);
-			} else if constexpr (std::is_same_v<T, double>) {
-				std::string str = std::to_string(arg);
-				remove_trailing_zeros(str);
-				return str;
-			} else if constexpr (std::is_same_v<T, std::string>) {
-				return arg;
-			} else {
-				static_assert(false, "non-exhaustive visitor!");
-			}
-		},
-		m_value);
+	ignore_warning_begin("-Wswitch-default");
+	switch (get_type()) {
+	case ValueType::NIL: return "nil";
+	case ValueType::BOOL: return as_bool() ? "true" : "false";
+	case ValueType::NUMBER: {
+		NumberBuffer buffer{};
+		return std::string(format_number(as_number(), buffer));
+	}
+	case ValueType::STRING: return std::string(get_string()->get_view());
+	}
+	ignore_warning_end();
 }
 
 std::ostream&
 operator<<(std::ostream& out_s, const Value& value)
 {
-	out_s << value.to_string();
+	if (value.is_number()) {
+		Value::NumberBuffer buffer{};
+		out_s << Value::format_number(value.as_number(), buffer);
+	} else if (value.is_string()) {
+		out_s << value.get_string()->get_view();
+	} else {
+		out_s << value.to_string();
+	}
 	return out_s;
 }
 
+std::string_view
+Value::format_number(const double number, NumberBuffer& buffer)
+{
+	// NaN and the infinities fail both tests, and come out as "nan" and "inf" in either notation.
+	const double magnitude = std::abs(number);
+	const bool is_fixed = magnitude == 0.0 || (magnitude >= 1e-7 && magnitude < 1e21);
+	const auto [end, error] = std::to_chars(buffer.data(), buffer.data() + buffer.size(), number,
+		is_fixed ? std::chars_format::fixed : std::chars_format::scientific);
+	require_assert(error == std::errc());
+	return {buffer.data(), end};
+}
+
 bool
 Value::operator==(const Value& other) const
 {
-	if (m_type != other.m_type) {
-		return false;
+	if (is_number() && other.is_number()) {
+		ignore_warning_begin("-Wfloat-equal");
+		const bool is_equal = as_number() == other.as_number();
+		ignore_warning_end();
+		return is_equal;
+	}
+	if (is_string() && other.is_string()) {
+		StringObject* string = get_string();
+		StringObject* other_string = other.get_string();
+		return string == other_string || (string->get_view().size() == other_string->get_view().size() &&
+											 string->get_hash() == other_string->get_hash() &&
+											 string->get_view() == other_string->get_view());
 	}
-	return m_value == other.m_value;
+	// Nil and the booleans each have a single pattern, which no number or string shares.
+	return m_bits == other.m_bits;
 }
 
 std::partial_ordering
 Value::operator<=>(const Value& other) const
 {
-	if (m_type != other.m_type) {
+	if (get_type() != other.get_type()) {
 		return std::partial_ordering::unordered;
 	}
-	if (m_value == other.m_value) {
-		return std::partial_ordering::equivalent;
+	ignore_warning_begin("-Wswitch-default");
+	switch (get_type()) {
+	case ValueType::NIL: return std::partial_ordering::equivalent;
+	case ValueType::BOOL: return as_bool() <=> other.as_bool();
+	case ValueType::NUMBER: return as_number() <=> other.as_number();
+	case ValueType::STRING:
+		if (m_bits == other.m_bits) {
+			return std::partial_ordering::equivalent;
+		}
+		return get_string()->get_view() <=> other.get_string()->get_view();
 	}
-	return m_value <=> other.m_value;
+	ignore_warning_end();
 }
 
 Value
@@ -157,8 +320,32 @@ Value::operator+(const Value& other) const
 		if (is_number() && other.is_number()) {
 			return Value(as_number() + other.as_number());
 		}
+		if (is_string()) {
+			// Appends to this string's buffer in place when it can; see `StringObject`.
+			if (other.is_string()) {
+				return Value(get_string()->append(other.get_string()->get_view()));
+			}
+			NumberBuffer buffer{};
+			return Value(get_string()->append(format_number(other.as_number(), buffer)));
+		}
 		return Value(to_string() + other.to_string());
 	}
-	throw std::runtime_error(
-		"Invalid operation: cannot add " + value_type_to_string(m_type) + " and " + value_type_to_string(other.m_type));
+	throw std::runtime_error("Invalid operation: cannot add " + value_type_to_string(get_type()) + " and " +
+							 value_type_to_string(other.get_type()));
+}
+
+// Private methods
+
+[[nodiscard]] Value::StringObject*
+Value::get_string() const
+{
+	return reinterpret_cast<StringObject*>(m_bits & ~string_tag); // NOLINT(performance-no-int-to-ptr)
+}
+
+void
+Value::release()
+{
+	if (is_string() && get_string()->release()) {
+		delete get_string(); // NOLINT(cppcoreguidelines-owning-memory)
+	}
 }
@@ -1,10 +1,12 @@
 #ifndef VALUE_H
 #define VALUE_H
 
+#include <array>
 #include <compare>
+#include <cstdint>
 #include <format>
 #include <string>
-#include <variant>
+#include <string_view>
 
 #include "general.h"
 
@@ -16,6 +18,13 @@ enum class ValueType
 	STRING,
 };
 
+/*
+ *	@brief
+ *		A Lox value in eight bytes, NaN-boxed. A number is stored as the bits of its double. Nil, the booleans and
+ *		strings are stored in the payload of a quiet NaN that arithmetic never produces, so a number is any pattern
+ *		without all of `quiet_nan` set. A string is the address of an immutable, reference-counted heap object that
+ *		all copies of the value share; see `StringObject` in value.cpp.
+ */
 class Value
 {
 public:
@@ -24,35 +33,66 @@ public:
 	explicit Value(int value);
 	explicit Value(double value);
 	explicit Value(const std::string& value);
+	explicit Value(std::string&& value);
+
+	Value(const Value& other);
+	Value(Value&& other) noexcept;
+	Value& operator=(const Value& other);
+	Value& operator=(Value&& other) noexcept;
+	~Value();
 
 	[[nodiscard]] ValueType get_type() const;
 
-	[[nodiscard]] bool is_nil() const;
-	[[nodiscard]] bool is_bool() const;
-	[[nodiscard]] bool is_number() const;
-	[[nodiscard]] bool is_string() const;
+	// Defined inline, as each is a single compare of the bits.
+	[[nodiscard]] bool is_nil() const { return m_bits == nil_bits; }
+	[[nodiscard]] bool is_bool() const { return (m_bits | 1U) == true_bits; }
+	[[nodiscard]] bool is_number() const { return (m_bits & quiet_nan) != quiet_nan; }
+	[[nodiscard]] bool is_string() const { return (m_bits & string_tag) == string_tag; }
 
 	[[nodiscard]] bool as_bool() const;
 	[[nodiscard]] double as_number() const;
 	[[nodiscard]] const std::string& as_string() const;
 
 	[[nodiscard]] std::string to_string() const;
+	// Writes numbers and strings without building a `std::string` first.
 	friend std::ostream& operator<<(std::ostream& out_s, const Value& value);
 
+	// Large enough for any number that `format_number` writes.
+	using NumberBuffer = std::array<char, 32>;
+
+	/*
+	 *	@brief
+	 *		Writes `number` into `buffer` with the fewest digits that read back as the same double, and returns the text.
+	 *		As in JavaScript, numbers from 1e-7 up to 1e21 are written in fixed notation and the others in scientific.
+	 */
+	[[nodiscard]] static std::string_view format_number(double number, NumberBuffer& buffer);
+
 	bool operator==(const Value& other) const;
 	[[nodiscard]] std::partial_ordering operator<=>(const Value& other) const;
 
 	Value operator+(const Value& other) const;
 
-	// std::variant automatically handles the copy/move constructors and assignment operators.
-	// The destructor is also automatically generated.
-
 private:
-	std::variant<std::monostate, bool, int, double, std::string> m_value;
-	ValueType m_type;
-	CLASS_PADDING(4);
+	static constexpr std::uint64_t sign_bit = 0x8000'0000'0000'0000;
+	static constexpr std::uint64_t quiet_nan = 0x7ffc'0000'0000'0000;
+	static constexpr std::uint64_t nil_bits = quiet_nan | 1U;
+	static constexpr std::uint64_t false_bits = quiet_nan | 2U;
+	static constexpr std::uint64_t true_bits = quiet_nan | 3U;
+	static constexpr std::uint64_t string_tag = sign_bit | quiet_nan;
+
+	class StringObject;
+
+	std::uint64_t m_bits;
+
+	// Takes over the caller's reference to `string`.
+	explicit Value(StringObject* string);
+
+	[[nodiscard]] StringObject* get_string() const;
+	void release();
 };
 
+static_assert(sizeof(Value) == sizeof(std::uint64_t));
+
 template <>
 struct std::formatter<Value> : std::formatter<std::string> {
 	auto format(const Value& value, format_context& ctx) const
@@ -8,40 +8,38 @@
 std::string
 RpnPrinter::convert_string(const Expr& expr)
 {
-	return std::any_cast<std::string>(expr.accept(*this));
+	return expr.accept(*this);
 }
 
 // =====================================================================================================================
 
-std::any
+std::string
 RpnPrinter::visit_assign_expr(const Assign& expr)
 {
-	return std::format("(= {} {})", expr.get_name().get_lexeme(),
-		std::any_cast<std::string>(expr.get_value()->accept(*this)));
+	return std::format("(= {} {})", expr.get_name().get_lexeme(), expr.get_value()->accept(*this));
 }
 
 // =====================================================================================================================
 
-std::any
+std::string
 RpnPrinter::visit_binary_expr(const Binary& expr)
 {
-	return std::format("{} {} {}", std::any_cast<std::string>(expr.get_left()->accept(*this)),
-		std::any_cast<std::string>(expr.get_right()->accept(*this)), expr.get_opr().get_lexeme());
+	return std::format(
+		"{} {} {}", expr.get_left()->accept(*this), expr.get_right()->accept(*this), expr.get_opr().get_lexeme());
 }
 
 // =====================================================================================================================
 
-std::any
+std::string
 RpnPrinter::visit_ternary_expr(const Ternary& expr)
 {
-	return std::format("{} {} {} {}", std::any_cast<std::string>(expr.get_condition()->accept(*this)),
-		std::any_cast<std::string>(expr.get_then_branch()->accept(*this)),
-		std::any_cast<std::string>(expr.get_else_branch()->accept(*this)), "<ternary>");
+	return std::format("{} {} {} {}", expr.get_condition()->accept(*this), expr.get_then_branch()->accept(*this),
+		expr.get_else_branch()->accept(*this), "<ternary>");
 }
 
 // =====================================================================================================================
 
-std::any
+std::string
 RpnPrinter::visit_grouping_expr(const Grouping& expr)
 {
 	return expr.get_expr()->accept(*this);
@@ -49,7 +47,7 @@ RpnPrinter::visit_grouping_expr(const Grouping& expr)
 
 // =====================================================================================================================
 
-std::any
+std::string
 RpnPrinter::visit_literal_expr(const Literal& expr)
 {
 	return std::format("{}", expr.get_value());
@@ -57,7 +55,7 @@ RpnPrinter::visit_literal_expr(const Literal& expr)
 
 // =====================================================================================================================
 
-std::any
+std::string
 RpnPrinter::visit_variable_expr(const Variable& expr)
 {
 	return std::format("(var {})", expr.get_name().get_lexeme());
@@ -65,9 +63,8 @@ RpnPrinter::visit_variable_expr(const Variable& expr)
 
 // =====================================================================================================================
 
-std::any
+std::string
 RpnPrinter::visit_unary_expr(const Unary& expr)
 {
-	return std::format("{} {}", std::any_cast<std::string>(expr.get_right()->accept(*this)),
-		expr.get_opr().get_lexeme());
+	return std::format("{} {}", expr.get_right()->accept(*this), expr.get_opr().get_lexeme());
 }
@@ -1,22 +1,21 @@
 #ifndef RPN_PRINTER_H
 #define RPN_PRINTER_H
 
-#include <any>
 #include <string>
 
 #include "asts/expr.h"
 
-class RpnPrinter : public ExprVisitor
+class RpnPrinter : public ExprVisitor<std::string>
 {
 public:
 	[[nodiscard]] std::string convert_string(const Expr& expr);
-	[[nodiscard]] std::any visit_assign_expr(const Assign& expr) override;
-	[[nodiscard]] std::any visit_binary_expr(const Binary& expr) override;
-	[[nodiscard]] std::any visit_ternary_expr(const Ternary& expr) override;
-	[[nodiscard]] std::any visit_grouping_expr(const Grouping& expr) override;
-	[[nodiscard]] std::any visit_literal_expr(const Literal& expr) override;
-	[[nodiscard]] std::any visit_variable_expr(const Variable& expr) override;
-	[[nodiscard]] std::any visit_unary_expr(const Unary& expr) override;
+	[[nodiscard]] std::string visit_assign_expr(const Assign& expr) override;
+	[[nodiscard]] std::string visit_binary_expr(const Binary& expr) override;
+	[[nodiscard]] std::string visit_ternary_expr(const Ternary& expr) override;
+	[[nodiscard]] std::string visit_grouping_expr(const Grouping& expr) override;
+	[[nodiscard]] std::string visit_literal_expr(const Literal& expr) override;
+	[[nodiscard]] std::string visit_variable_expr(const Variable& expr) override;
+	[[nodiscard]] std::string visit_unary_expr(const Unary& expr) override;
 };
 
 #endif // RPN_PRINTER_H
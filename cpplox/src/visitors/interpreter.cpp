@@ -1,12 +1,13 @@
 #include "interpreter.h"
 
-#include <any>
 #include <cassert>
 #include <cstddef>
 #include <cstdlib>
 #include <memory>
+#include <optional>
 #include <string>
 #include <tuple>
+#include <utility>
 
 #include "general.h"
 #include "lox.h"
@@ -19,15 +20,10 @@
 namespace {
 
 void
-check_comparison_operands(const Token& opr, const std::any& left, const std::any& right)
+check_comparison_operands(const Token& opr, const Value& left, const Value& right)
 {
-	if (left.has_value() && right.has_value() && left.type() == typeid(Value) && right.type() == typeid(Value)) {
-		const Value& left_value = std::any_cast<Value>(left);
-		const Value& right_value = std::any_cast<Value>(right);
-		if ((left_value.is_number() && right_value.is_number()) ||
-			(left_value.is_string() && right_value.is_string())) {
-			return;
-		}
+	if ((left.is_number() && right.is_number()) || (left.is_string() && right.is_string())) {
+		return;
 	}
 	throw RuntimeError(opr, "Operands must be numbers or strings at the same time.");
 }
@@ -35,13 +31,10 @@ check_comparison_operands(const Token& opr, const std::any& left, const std::any
 // =====================================================================================================================
 
 void
-check_number_operand(const Token& opr, const std::any& operand)
+check_number_operand(const Token& opr, const Value& operand)
 {
-	if (operand.has_value() && operand.type() == typeid(Value)) {
-		const Value& value = std::any_cast<Value>(operand);
-		if (value.is_number()) {
-			return;
-		}
+	if (operand.is_number()) {
+		return;
 	}
 	throw RuntimeError(opr, "Operand must be number.");
 }
@@ -49,14 +42,10 @@ check_number_operand(const Token& opr, const std::any& operand)
 // =====================================================================================================================
 
 void
-check_number_operands(const Token& opr, const std::any& left, const std::any& right)
+check_number_operands(const Token& opr, const Value& left, const Value& right)
 {
-	if (left.has_value() && right.has_value() && left.type() == typeid(Value) && right.type() == typeid(Value)) {
-		const Value& left_value = std::any_cast<Value>(left);
-		const Value& right_value = std::any_cast<Value>(right);
-		if (left_value.is_number() && right_value.is_number()) {
-			return;
-		}
+	if (left.is_number() && right.is_number()) {
+		return;
 	}
 	throw RuntimeError(opr, "Operands must be numbers.");
 }
@@ -64,16 +53,10 @@ check_number_operands(const Token& opr, const std::any& left, const std::any& ri
 // =====================================================================================================================
 
 void
-check_number_or_string_operands(const Token& opr, const std::any& left, const std::any& right)
+check_number_or_string_operands(const Token& opr, const Value& left, const Value& right)
 {
-
-	if (left.has_value() && right.has_value() && left.type() == typeid(Value) && right.type() == typeid(Value)) {
-		const Value& left_value = std::any_cast<Value>(left);
-		const Value& right_value = std::any_cast<Value>(right);
-		if ((left_value.is_number() || left_value.is_string()) &&
-			(right_value.is_number() || right_value.is_string())) {
-			return;
-		}
+	if ((left.is_number() || left.is_string()) && (right.is_number() || right.is_string())) {
+		return;
 	}
 	throw RuntimeError(opr, "Operands must be numbers or strings.");
 }
@@ -81,55 +64,91 @@ check_number_or_string_operands(const Token& opr, const std::any& left, const st
 // =====================================================================================================================
 
 bool
-is_truthy(const std::any& any)
+is_truthy(const Value& value)
 {
-	if (!any.has_value()) {
+	if (value.is_nil()) {
 		return false;
 	}
-	if (any.type() == typeid(std::nullptr_t)) {
-		return false;
+	if (value.is_bool()) {
+		return value.as_bool();
 	}
-	if (any.type() == typeid(Value)) {
-		const Value& value = std::any_cast<Value>(any);
-		if (value.is_nil()) {
-			return false;
-		}
-		if (value.is_bool()) {
-			return value.as_bool();
-		}
-		if (value.is_number()) {
-			return value.as_number() != 0.0;
-		}
+	if (value.is_number()) {
+		return value.as_number() != 0.0;
 	}
 	return true;
 }
 
 // =====================================================================================================================
 
-bool
-is_equal(const std::any& a, const std::any& b)
+Value
+apply_binary(const Token& opr, const Value& left, const Value& right)
 {
-	// Check if both are empty.
-	if (!a.has_value() && !b.has_value()) {
-		return true;
-	}
-	// If only one is empty, return false.
-	if (!a.has_value() || !b.has_value()) {
-		return false;
-	}
+	// Number operations.
+	ignore_warning_begin("-Wswitch-enum");
+	switch (opr.get_type()) {
 
-	// Check if both are of the same type.
-	if (a.type() != b.type()) {
-		return false;
+	// Equality.
+	case TokenType::BANG_EQUAL: return Value(left != right);
+	case TokenType::EQUAL_EQUAL: return Value(left == right);
+
+	// Comparison.
+	case TokenType::GREATER:
+		check_comparison_operands(opr, left, right);
+		return Value(left > right);
+	case TokenType::GREATER_EQUAL:
+		check_comparison_operands(opr, left, right);
+		return Value(left >= right);
+	case TokenType::LESS:
+		check_comparison_operands(opr, left, right);
+		return Value(left < right);
+	case TokenType::LESS_EQUAL:
+		check_comparison_operands(opr, left, right);
+		return Value(left <= right);
+
+	// Addition and subtraction.
+	case TokenType::MINUS:
+		check_number_operands(opr, left, right);
+		return Value(left.as_number() - right.as_number());
+	case TokenType::PLUS:
+		// Number or string addition.
+		check_number_or_string_operands(opr, left, right);
+		return Value(left + right);
+
+	// Factor.
+	case TokenType::STAR:
+		check_number_operands(opr, left, right);
+		return Value(left.as_number() * right.as_number());
+	case TokenType::SLASH:
+		check_number_operands(opr, left, right);
+		if (right.as_number() == 0.0) {
+			// Division by zero.
+			throw RuntimeError(opr, "Division by zero.");
+		}
+		return Value(left.as_number() / right.as_number());
+	default: break;
 	}
+	ignore_warning_end();
 
-	if (a.type() == typeid(Value)) {
-		const Value& a_value = std::any_cast<Value>(a);
-		const Value& b_value = std::any_cast<Value>(b);
-		return a_value == b_value;
+	// The comma operator is parsed but not evaluated yet.
+	return Value();
+}
+
+// =====================================================================================================================
+
+Value
+apply_unary(const Token& opr, const Value& right)
+{
+	ignore_warning_begin("-Wswitch-enum");
+	switch (opr.get_type()) {
+	case TokenType::BANG: return Value(!is_truthy(right));
+	case TokenType::MINUS: {
+		check_number_operand(opr, right);
+		return Value(-right.as_number());
 	}
-	// Asserts that unknown types are not handled.
-	require_assert_message(false, "Unknown type in is_equal");
+	default: break;
+	}
+	ignore_warning_end();
+	require_assert_message(false, "Unknown unary operator");
 }
 
 } // namespace
@@ -151,7 +170,10 @@ Interpreter::interpret(const std::vector<std::shared_ptr<Stmt>>& statements)
 {
 	try {
 		m_last_expression_evaluated = false;
-		m_last_expression_result = std::any();
+		m_last_expression_result = Value();
+		// A runtime error leaves the steps and operands of the evaluation it interrupted behind.
+		m_steps.clear();
+		m_operands.clear();
 		for (const std::shared_ptr<Stmt>& statement : statements) {
 			execute(statement);
 		}
@@ -165,8 +187,7 @@ Interpreter::interpret(const std::vector<std::shared_ptr<Stmt>>& statements)
 void
 Interpreter::print_expression(const std::shared_ptr<const Expr>& expr)
 {
-	std::any result = evaluate(expr);
-	std::cout << stringify(result) << std::endl;
+	std::cout << stringify(evaluate(expr)) << std::endl;
 }
 
 // =====================================================================================================================
@@ -175,12 +196,12 @@ void
 Interpreter::reset_last_expression_state()
 {
 	m_last_expression_evaluated = false;
-	m_last_expression_result = std::any();
+	m_last_expression_result = Value();
 }
 
 // =====================================================================================================================
 
-std::any
+Value
 Interpreter::get_last_expression_result(bool& out_last_expression_evaluated)
 {
 	out_last_expression_evaluated = m_last_expression_evaluated;
@@ -190,114 +211,52 @@ Interpreter::get_last_expression_result(bool& out_last_expression_evaluated)
 // =====================================================================================================================
 
 std::string
-Interpreter::stringify(const std::any& any, const bool is_print_statement)
+Interpreter::stringify(const Value& value, const bool is_print_statement)
 {
-	if (!any.has_value()) {
-		return "nil";
+	std::string value_str = value.to_string();
+	if (!is_print_statement && value.is_string()) {
+		value_str = "\"" + value_str + "\"";
 	}
-	if (any.type() == typeid(Value)) {
-		const Value& value = std::any_cast<Value>(any);
-		std::string value_str = std::any_cast<Value>(any).to_string();
-		if (!is_print_statement && value.is_string()) {
-			value_str = "\"" + value_str + "\"";
-		}
-		return value_str;
-	}
-	require_assert_message(false, "Unknown type in stringify");
+	return value_str;
 }
 
 // =====================================================================================================================
-// Visit expression.
+// Visit expression. A node with operands is evaluated by `evaluate`, which does not recurse into them.
 
 // ====================================================================================================================
-std::any
+Value
 Interpreter::visit_assign_expr(const Assign& expr)
 {
-	std::any value = evaluate(expr.get_value());
-	m_environment->assign(expr.get_name(), value);
-	return value;
+	return evaluate(expr);
 }
 
 // =====================================================================================================================
 
-std::any
+Value
 Interpreter::visit_binary_expr(const Binary& expr)
 {
-	std::any left = evaluate(expr.get_left());
-	std::any right = evaluate(expr.get_right());
-
-	// Number operations.
-	ignore_warning_begin("-Wswitch-enum");
-	switch (expr.get_opr().get_type()) {
-
-	// Equality.
-	case TokenType::BANG_EQUAL: return Value(!is_equal(left, right));
-	case TokenType::EQUAL_EQUAL: return Value(is_equal(left, right));
-
-	// Comparison.
-	case TokenType::GREATER:
-		check_comparison_operands(expr.get_opr(), left, right);
-		return Value(std::any_cast<Value>(left) > std::any_cast<Value>(right));
-	case TokenType::GREATER_EQUAL:
-		check_comparison_operands(expr.get_opr(), left, right);
-		return Value(std::any_cast<Value>(left) >= std::any_cast<Value>(right));
-	case TokenType::LESS:
-		check_comparison_operands(expr.get_opr(), left, right);
-		return Value(std::any_cast<Value>(left) < std::any_cast<Value>(right));
-	case TokenType::LESS_EQUAL:
-		check_comparison_operands(expr.get_opr(), left, right);
-		return Value(std::any_cast<Value>(left) <= std::any_cast<Value>(right));
-
-	// Addition and subtraction.
-	case TokenType::MINUS:
-		check_number_operands(expr.get_opr(), left, right);
-		return Value(std::any_cast<Value>(left).as_number() - std::any_cast<Value>(right).as_number());
-	case TokenType::PLUS:
-		// Number or string addition.
-		check_number_or_string_operands(expr.get_opr(), left, right);
-		return Value(std::any_cast<Value>(left) + std::any_cast<Value>(right));
-
-	// Factor.
-	case TokenType::STAR:
-		check_number_operands(expr.get_opr(), left, right);
-		return Value(std::any_cast<Value>(left).as_number() * std::any_cast<Value>(right).as_number());
-	case TokenType::SLASH:
-		check_number_operands(expr.get_opr(), left, right);
-		if (std::any_cast<Value>(right).as_number() == 0.0) {
-			// Division by zero.
-			throw RuntimeError(expr.get_opr(), "Division by zero.");
-		}
-		return Value(std::any_cast<Value>(left).as_number() / std::any_cast<Value>(right).as_number());
-	default: break;
-	}
-	ignore_warning_end();
-
-	return {};
+	return evaluate(expr);
 }
 
 // ====================================================================================================================
 
-std::any
+Value
 Interpreter::visit_ternary_expr(const Ternary& expr)
 {
-	if (is_truthy(evaluate(expr.get_condition()))) {
-		return evaluate(expr.get_then_branch());
-	} else { // NOLINT(llvm-else-after-return, readability-else-after-return)
-		return evaluate(expr.get_else_branch());
-	}
+	return evaluate(expr);
 }
 
 // ====================================================================================================================
 
-std::any
+Value
 Interpreter::visit_grouping_expr(const Grouping& expr)
 {
-	return evaluate(expr.get_expr());
+	return evaluate(expr);
 }
 
 // =====================================================================================================================
 
-std::any
+Value
 Interpreter::visit_literal_expr(const Literal& expr)
 {
 	return expr.get_value();
@@ -305,7 +264,7 @@ Interpreter::visit_literal_expr(const Literal& expr)
 
 // ====================================================================================================================
 
-std::any
+Value
 Interpreter::visit_variable_expr(const Variable& expr)
 {
 	return m_environment->get(expr.get_name());
@@ -313,22 +272,10 @@ Interpreter::visit_variable_expr(const Variable& expr)
 
 // =====================================================================================================================
 
-std::any
+Value
 Interpreter::visit_unary_expr(const Unary& expr)
 {
-	const std::any right = evaluate(expr.get_right());
-
-	ignore_warning_begin("-Wswitch-enum");
-	switch (expr.get_opr().get_type()) {
-	case TokenType::BANG: return Value(!is_truthy(right));
-	case TokenType::MINUS: {
-		check_number_operand(expr.get_opr(), right);
-		return Value(-std::any_cast<Value>(right).as_number());
-	}
-	default: break;
-	}
-	ignore_warning_end();
-	require_assert_message(false, "Unknown unary operator");
+	return evaluate(expr);
 }
 
 // =====================================================================================================================
@@ -336,70 +283,162 @@ Interpreter::visit_unary_expr(const Unary& expr)
 
 // ====================================================================================================================
 
-std::any
+void
 Interpreter::visit_var_stmt(const Var& stmt)
 {
-	std::any value;
+	std::optional<Value> value;
 	if (stmt.get_initializer()) {
 		value = evaluate(stmt.get_initializer());
 	}
-	m_environment->define(stmt.get_name(), value);
-	return Value();
+	m_environment->define(stmt.get_name(), std::move(value));
 }
 
 // =====================================================================================================================
 
-std::any
+void
 Interpreter::visit_expression_stmt(const Expression& stmt)
 {
 	std::ignore = evaluate(stmt.get_expr());
-	return Value();
 }
 
 // =====================================================================================================================
 
-std::any
+void
 Interpreter::visit_expressionresult_stmt(const ExpressionResult& stmt)
 {
 	m_last_expression_result = evaluate(stmt.get_expr());
 	m_last_expression_evaluated = true;
-	return Value();
 }
 
 // =====================================================================================================================
 
-std::any
+void
 Interpreter::visit_print_stmt(const Print& stmt)
 {
-	std::any result = evaluate(stmt.get_expr());
-	std::cout << stringify(result, true) << std::endl;
-	return Value();
+	// The value is written straight to the stream, so printing a number or a string does not allocate.
+	std::cout << evaluate(stmt.get_expr()) << std::endl;
 }
 
 // =====================================================================================================================
 
-std::any
+void
 Interpreter::visit_block_stmt(const Block& stmt)
 {
 	std::unique_ptr<Environment> block_environment = std::make_unique<Environment>(m_environment.get());
 	execute_block(stmt.get_statements(), std::move(block_environment));
-	return Value();
 }
 
 // =====================================================================================================================
 // Private methods
 
-std::any
+Value
 Interpreter::evaluate(const std::shared_ptr<const Expr>& expr)
 {
 	require_assert(expr);
-	return expr->accept(*this);
+	return evaluate(*expr);
+}
+
+/*
+ *	@brief
+ *		Evaluates `expr` without recursing. Each node is a step on `m_steps`: evaluating a node with operands schedules
+ *		the steps that evaluate them above a step that applies the node, which finds their values on top of
+ *		`m_operands` and replaces them with its own. Operands are evaluated, and errors raised, in the same order as
+ *		a recursive evaluation would.
+ */
+Value
+Interpreter::evaluate(const Expr& expr)
+{
+	const size_t base = m_steps.size();
+	m_steps.emplace_back(&expr, false);
+	while (m_steps.size() > base) {
+		const Step step = m_steps.back();
+		m_steps.pop_back();
+		if (step.is_apply) {
+			apply(*step.expr);
+		} else {
+			schedule(*step.expr);
+		}
+	}
+	Value result = std::move(m_operands.back());
+	m_operands.pop_back();
+	return result;
+}
+
+void
+Interpreter::schedule(const Expr& expr)
+{
+	ignore_warning_begin("-Wswitch-default");
+	switch (expr.kind()) {
+	case ExprKind::ASSIGN:
+		m_steps.emplace_back(&expr, true);
+		m_steps.emplace_back(static_cast<const Assign&>(expr).get_value().get(), false);
+		break;
+	case ExprKind::BINARY: {
+		// The left operand is scheduled last, so that it is evaluated first.
+		const auto& binary = static_cast<const Binary&>(expr);
+		m_steps.emplace_back(&expr, true);
+		m_steps.emplace_back(binary.get_right().get(), false);
+		m_steps.emplace_back(binary.get_left().get(), false);
+		break;
+	}
+	case ExprKind::GROUPING:
+		// A grouping's value is its expression's.
+		m_steps.emplace_back(static_cast<const Grouping&>(expr).get_expr().get(), false);
+		break;
+	case ExprKind::TERNARY:
+		// Once the condition is evaluated, applying the node schedules the branch it picks.
+		m_steps.emplace_back(&expr, true);
+		m_steps.emplace_back(static_cast<const Ternary&>(expr).get_condition().get(), false);
+		break;
+	case ExprKind::UNARY:
+		m_steps.emplace_back(&expr, true);
+		m_steps.emplace_back(static_cast<const Unary&>(expr).get_right().get(), false);
+		break;
+	case ExprKind::LITERAL:
+	case ExprKind::VARIABLE: m_operands.push_back(expr.accept(*this)); break;
+	}
+	ignore_warning_end();
+}
+
+void
+Interpreter::apply(const Expr& expr)
+{
+	ignore_warning_begin("-Wswitch-default");
+	switch (expr.kind()) {
+	case ExprKind::ASSIGN:
+		// The assigned value is also the value of the assignment.
+		m_environment->assign(static_cast<const Assign&>(expr).get_name(), m_operands.back());
+		break;
+	case ExprKind::BINARY: {
+		const Value right = std::move(m_operands.back());
+		m_operands.pop_back();
+		Value& left = m_operands.back();
+		left = apply_binary(static_cast<const Binary&>(expr).get_opr(), left, right);
+		break;
+	}
+	case ExprKind::TERNARY: {
+		const auto& ternary = static_cast<const Ternary&>(expr);
+		const bool condition = is_truthy(m_operands.back());
+		m_operands.pop_back();
+		m_steps.emplace_back((condition ? ternary.get_then_branch() : ternary.get_else_branch()).get(), false);
+		break;
+	}
+	case ExprKind::UNARY: {
+		Value& right = m_operands.back();
+		right = apply_unary(static_cast<const Unary&>(expr).get_opr(), right);
+		break;
+	}
+	case ExprKind::GROUPING:
+	case ExprKind::LITERAL:
+	case ExprKind::VARIABLE: require_assert_message(false, "Only a node with operands is applied");
+	}
+	ignore_warning_end();
 }
 
 void
 Interpreter::execute(const std::shared_ptr<const Stmt>& statement)
 {
-	std::ignore = statement->accept(*this);
+	statement->accept(*this);
 }
 
 void
@@ -1,50 +1,67 @@
 #ifndef INTERPRETER_H
 #define INTERPRETER_H
 
-#include <any>
 #include <memory>
+#include <vector>
 
 #include "asts/expr.h"
 #include "asts/stmt.h"
 #include "environment.h"
 #include "general.h"
+#include "value.h"
 
-class Interpreter : public ExprVisitor, public StmtVisitor
+class Interpreter : public ExprVisitor<Value>, public StmtVisitor<void>
 {
 public:
 	Interpreter();
 
 	// Visit expression.
-	[[nodiscard]] std::any visit_assign_expr(const Assign& expr) override;
-	[[nodiscard]] std::any visit_binary_expr(const Binary& expr) override;
-	[[nodiscard]] std::any visit_ternary_expr(const Ternary& expr) override;
-	[[nodiscard]] std::any visit_grouping_expr(const Grouping& expr) override;
-	[[nodiscard]] std::any visit_literal_expr(const Literal& expr) override;
-	[[nodiscard]] std::any visit_variable_expr(const Variable& expr) override;
-	[[nodiscard]] std::any visit_unary_expr(const Unary& expr) override;
+	[[nodiscard]] Value visit_assign_expr(const Assign& expr) override;
+	[[nodiscard]] Value visit_binary_expr(const Binary& expr) override;
+	[[nodiscard]] Value visit_ternary_expr(const Ternary& expr) override;
+	[[nodiscard]] Value visit_grouping_expr(const Grouping& expr) override;
+	[[nodiscard]] Value visit_literal_expr(const Literal& expr) override;
+	[[nodiscard]] Value visit_variable_expr(const Variable& expr) override;
+	[[nodiscard]] Value visit_unary_expr(const Unary& expr) override;
 
 	// Visit statement.
-	[[nodiscard]] std::any visit_var_stmt(const Var& stmt) override;
-	[[nodiscard]] std::any visit_expression_stmt(const Expression& stmt) override;
-	[[nodiscard]] std::any visit_expressionresult_stmt(const ExpressionResult& stmt) override;
-	[[nodiscard]] std::any visit_print_stmt(const Print& stmt) override;
-	[[nodiscard]] std::any visit_block_stmt(const Block& stmt) override;
+	void visit_var_stmt(const Var& stmt) override;
+	void visit_expression_stmt(const Expression& stmt) override;
+	void visit_expressionresult_stmt(const ExpressionResult& stmt) override;
+	void visit_print_stmt(const Print& stmt) override;
+	void visit_block_stmt(const Block& stmt) override;
 
 	void interpret(const std::vector<std::shared_ptr<Stmt>>& statements);
 	void print_expression(const std::shared_ptr<const Expr>& expr);
 
 	// Reset the state of last expression (used when starting a new parsing run)
 	void reset_last_expression_state();
-	std::any get_last_expression_result(bool& out_last_expression_evaluated);
-	[[nodiscard]] static std::string stringify(const std::any& any, bool is_print_statement = false);
+	Value get_last_expression_result(bool& out_last_expression_evaluated);
+	[[nodiscard]] static std::string stringify(const Value& value, bool is_print_statement = false);
 
 private:
+	// An expression to evaluate or, once the values of its operands are on `m_operands`, to apply to them.
+	struct Step {
+		Step(const Expr* step_expr, bool step_is_apply) : expr(step_expr), is_apply(step_is_apply) {}
+
+		const Expr* expr;
+		bool is_apply;
+		CLASS_PADDING(7);
+	};
+
 	std::unique_ptr<Environment> m_environment;
-	std::any m_last_expression_result;
+	// The steps left of the expressions being evaluated, next last, and the values of the operands evaluated so far.
+	// Both are reused, so an expression of any depth costs no native stack and, once they have grown, no allocation.
+	std::vector<Step> m_steps;
+	std::vector<Value> m_operands;
+	Value m_last_expression_result;
 	bool m_last_expression_evaluated = false;
 	CLASS_PADDING(7);
 
-	[[nodiscard]] std::any evaluate(const std::shared_ptr<const Expr>& expr);
+	[[nodiscard]] Value evaluate(const std::shared_ptr<const Expr>& expr);
+	[[nodiscard]] Value evaluate(const Expr& expr);
+	void schedule(const Expr& expr);
+	void apply(const Expr& expr);
 	void execute(const std::shared_ptr<const Stmt>& statement);
 	void execute_block(const std::vector<std::shared_ptr<const Stmt>>& statements,
 		std::unique_ptr<Environment> block_environment);